@@ -0,0 +1,214 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+constexpr i32 MAX_ATLAS_SIZE {16384};
+
+// skyline bottom-left packer
+class skyline_packer {
+public:
+    explicit skyline_packer(size_i size)
+        : _size {size}
+        , _skyline {{.X = 0, .Y = 0, .Width = size.Width}}
+    {
+    }
+
+    auto insert(size_i size) -> std::optional<point_i>
+    {
+        i32   bestY {std::numeric_limits<i32>::max()};
+        i32   bestX {0};
+        usize bestIdx {_skyline.size()};
+
+        for (usize i {0}; i < _skyline.size(); ++i) {
+            if (auto const y {fit(i, size)}; y && (*y < bestY || (*y == bestY && _skyline[i].X < bestX))) {
+                bestY   = *y;
+                bestX   = _skyline[i].X;
+                bestIdx = i;
+            }
+        }
+
+        if (bestIdx == _skyline.size()) {
+            return std::nullopt;
+        }
+
+        add_level(bestIdx, {bestX, bestY}, size);
+        return point_i {bestX, bestY};
+    }
+
+private:
+    struct segment {
+        i32 X {0};
+        i32 Y {0};
+        i32 Width {0};
+    };
+
+    auto fit(usize idx, size_i size) const -> std::optional<i32>
+    {
+        i32 const x {_skyline[idx].X};
+        if (x + size.Width > _size.Width) {
+            return std::nullopt;
+        }
+
+        i32 y {0};
+        i32 widthLeft {size.Width};
+        for (usize i {idx}; widthLeft > 0; ++i) {
+            y = std::max(y, _skyline[i].Y);
+            if (y + size.Height > _size.Height) {
+                return std::nullopt;
+            }
+            widthLeft -= _skyline[i].Width;
+        }
+        return y;
+    }
+
+    void add_level(usize idx, point_i pos, size_i size)
+    {
+        _skyline.insert(_skyline.begin() + static_cast<isize>(idx), {.X = pos.X, .Y = pos.Y + size.Height, .Width = size.Width});
+
+        // shrink or remove the segments covered by the new one
+        for (usize i {idx + 1}; i < _skyline.size();) {
+            auto&     seg {_skyline[i]};
+            i32 const right {pos.X + size.Width};
+            if (seg.X >= right) {
+                break;
+            }
+
+            i32 const shrink {right - seg.X};
+            if (shrink < seg.Width) {
+                seg.X += shrink;
+                seg.Width -= shrink;
+                break;
+            }
+            _skyline.erase(_skyline.begin() + static_cast<isize>(i));
+        }
+
+        // merge neighbours on the same level
+        for (usize i {0}; i + 1 < _skyline.size();) {
+            if (_skyline[i].Y == _skyline[i + 1].Y) {
+                _skyline[i].Width += _skyline[i + 1].Width;
+                _skyline.erase(_skyline.begin() + static_cast<isize>(i + 1));
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    size_i               _size;
+    std::vector<segment> _skyline;
+};
+
+static void blit(gfx::image& dst, gfx::image const& src, point_i pos)
+{
+    auto const& srcInfo {src.info()};
+    auto const  srcBpp {srcInfo.bytes_per_pixel()};
+    auto const  dstStride {dst.info().stride()};
+    auto const  srcBuf {src.data()};
+    auto        dstBuf {dst.data()};
+
+    for (i32 y {0}; y < srcInfo.Size.Height; ++y) {
+        u8 const* srcRow {srcBuf.data() + (static_cast<isize>(y) * srcInfo.stride())};
+        u8*       dstRow {dstBuf.data() + (static_cast<isize>(pos.Y + y) * dstStride) + (static_cast<isize>(pos.X) * 4)};
+        for (i32 x {0}; x < srcInfo.Size.Width; ++x) {
+            u8 const* s {srcRow + (static_cast<isize>(x) * srcBpp)};
+            u8*       d {dstRow + (static_cast<isize>(x) * 4)};
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+            d[3] = srcBpp == 4 ? s[3] : 255;
+        }
+    }
+}
+
+auto pack_atlas(std::vector<std::string> const& files, i32 gap) -> std::optional<atlas>
+{
+    struct entry {
+        std::string Name;
+        gfx::image  Image;
+        point_i     Position;
+    };
+
+    std::vector<entry> entries;
+    i64                area {0};
+    for (auto const& file : files) {
+        auto img {gfx::image::Load(file)};
+        if (!img) {
+            std::cerr << "error loading image: " << file << "\n";
+            continue;
+        }
+        auto const size {img->info().Size};
+        area += static_cast<i64>(size.Width + gap) * (size.Height + gap);
+        entries.push_back({.Name = io::get_stem(file), .Image = std::move(*img), .Position = {}});
+    }
+
+    if (entries.empty()) {
+        return std::nullopt;
+    }
+
+    // tallest first, then widest
+    std::ranges::sort(entries, [](entry const& a, entry const& b) {
+        auto const& sa {a.Image.info().Size};
+        auto const& sb {b.Image.info().Size};
+        return sa.Height != sb.Height ? sa.Height > sb.Height : sa.Width > sb.Width;
+    });
+
+    auto const tooLarge {[](size_i size) {
+        if (size.Width <= MAX_ATLAS_SIZE && size.Height <= MAX_ATLAS_SIZE) {
+            return false;
+        }
+        std::cerr << "images do not fit into a " << MAX_ATLAS_SIZE << "x" << MAX_ATLAS_SIZE << " atlas\n";
+        return true;
+    }};
+
+    // start at the smallest power of two square that can hold the total area and grow from there
+    size_i atlasSize {1, 1};
+    while (static_cast<i64>(atlasSize.Width) * atlasSize.Height < area && atlasSize.Width <= MAX_ATLAS_SIZE) {
+        if (atlasSize.Width <= atlasSize.Height) {
+            atlasSize.Width *= 2;
+        } else {
+            atlasSize.Height *= 2;
+        }
+    }
+    if (tooLarge(atlasSize)) {
+        return std::nullopt;
+    }
+
+    for (;;) {
+        // the packer works on an area inset by one gap, so there's a gap at every edge
+        skyline_packer packer {{atlasSize.Width - gap, atlasSize.Height - gap}};
+        bool           fits {true};
+        for (auto& e : entries) {
+            auto const size {e.Image.info().Size};
+            if (auto const pos {packer.insert({size.Width + gap, size.Height + gap})}) {
+                e.Position = {pos->X + gap, pos->Y + gap};
+            } else {
+                fits = false;
+                break;
+            }
+        }
+        if (fits) {
+            break;
+        }
+
+        if (atlasSize.Width <= atlasSize.Height) {
+            atlasSize.Width *= 2;
+        } else {
+            atlasSize.Height *= 2;
+        }
+        if (tooLarge(atlasSize)) {
+            return std::nullopt;
+        }
+    }
+
+    atlas retValue {.Image = gfx::image::CreateEmpty(atlasSize, gfx::image::format::RGBA), .Regions = {}};
+    for (auto const& e : entries) {
+        auto const size {e.Image.info().Size};
+        blit(retValue.Image, e.Image, e.Position);
+        retValue.Regions.push_back({.Name = e.Name, .Bounds = {e.Position.X, e.Position.Y, size.Width, size.Height}});
+    }
+
+    std::ranges::sort(retValue.Regions, {}, &atlas_region::Name);
+    return retValue;
+}
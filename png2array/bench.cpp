@@ -0,0 +1,232 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+// Measures png2array runtime and output size per image size and output mode, and what the
+// generated header costs the compiler. Writes CSV to stdout.
+
+#include "../shared/argparse.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <tcob/tcob.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <spawn.h>
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+extern char** environ;
+#endif
+
+using namespace tcob;
+namespace fs = std::filesystem;
+
+struct process_result {
+    f64 Milliseconds {0};
+    i64 PeakKiB {-1}; // -1 if not available on this platform
+    i32 ExitCode {-1};
+};
+
+static auto run_process(std::vector<std::string> const& args, fs::path const& stdoutFile) -> process_result
+{
+    process_result retValue;
+    stopwatch      sw {stopwatch::StartNew()};
+
+#if defined(__unix__) || defined(__APPLE__)
+    std::vector<char*> argv;
+    for (auto const& arg : args) { argv.push_back(const_cast<char*>(arg.c_str())); }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, stdoutFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    pid_t pid {0};
+    if (posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ) == 0) {
+        int           status {0};
+        struct rusage usage {};
+        if (wait4(pid, &status, 0, &usage) == pid) {
+            retValue.ExitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    #if defined(__APPLE__)
+            retValue.PeakKiB = usage.ru_maxrss / 1024;
+    #else
+            retValue.PeakKiB = usage.ru_maxrss;
+    #endif
+        }
+    }
+    posix_spawn_file_actions_destroy(&actions);
+#else
+    std::string cmd;
+    for (auto const& arg : args) { cmd += "\"" + arg + "\" "; }
+    cmd += "> \"" + stdoutFile.string() + "\" 2>NUL";
+    retValue.ExitCode = std::system(("\"" + cmd + "\"").c_str());
+#endif
+
+    retValue.Milliseconds = sw.elapsed_milliseconds();
+    return retValue;
+}
+
+// sum of the file sizes of a header, or of all headers in a folder
+static auto header_bytes(fs::path const& path) -> u64
+{
+    if (!fs::is_directory(path)) { return fs::file_size(path); }
+
+    u64 retValue {0};
+    for (auto const& entry : fs::directory_iterator {path}) {
+        if (entry.path().extension() == ".hpp") { retValue += entry.file_size(); }
+    }
+    return retValue;
+}
+
+// smooth gradients with some noise, so reduction and compression behave like on real assets;
+// palette images snap the colors to 6 levels per channel (216 colors) and are opaque
+static auto make_image(i32 size, bool palette = false) -> gfx::image
+{
+    auto img {gfx::image::CreateEmpty({size, size}, gfx::image::format::RGBA)};
+    auto buf {img.data()};
+    u32  seed {12345};
+    for (i32 y {0}; y < size; ++y) {
+        for (i32 x {0}; x < size; ++x) {
+            seed = (seed * 1664525) + 1013904223;
+            i32 const noise {static_cast<i32>(seed >> 28) - 8};
+            u8*       p {buf.data() + ((static_cast<isize>(y) * size) + x) * 4};
+            p[0] = static_cast<u8>(std::clamp((x * 255 / size) + noise, 0, 255));
+            p[1] = static_cast<u8>(std::clamp((y * 255 / size) + noise, 0, 255));
+            p[2] = static_cast<u8>(((x + y) * 127 / size));
+            p[3] = static_cast<u8>(x < size / 2 ? 255 : 255 - (y * 255 / size));
+            if (palette) {
+                for (i32 c {0}; c < 3; ++c) { p[c] = static_cast<u8>((p[c] + 25) / 51 * 51); }
+                p[3] = 255;
+            }
+        }
+    }
+    return img;
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+    argparse::ArgumentParser program("png2array_bench");
+    program.add_argument("--max-size")
+        .help("largest image edge length")
+        .default_value(1024)
+        .scan<'i', i32>();
+    program.add_argument("--work-dir")
+        .help("folder for generated images and headers")
+        .default_value("png2array_bench");
+    program.add_argument("--png2array")
+        .help("png2array executable")
+        .default_value(std::string {PNG2ARRAY_EXE});
+    program.add_argument("--cxx")
+        .help("compiler used to measure the cost of the generated headers (gcc/clang style)")
+        .default_value(std::string {PNG2ARRAY_BENCH_CXX});
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (std::exception const& err) {
+        std::cout << err.what() << '\n';
+        std::cout << program;
+        return 1;
+    }
+
+    auto pl {platform::HeadlessInit()};
+
+    std::string const exe {program.get("--png2array")};
+    std::string const cxx {program.get("--cxx")};
+    fs::path const    workDir {fs::absolute(program.get("--work-dir"))};
+    i32 const         maxSize {program.get<i32>("--max-size")};
+
+    struct mode {
+        std::string              Name;
+        std::vector<std::string> Args;
+        bool                     Atlas {false};   // packs four images of half the size into one atlas
+        bool                     Palette {false}; // converts an image with at most 256 colors
+        bool                     Folder {false};  // writes per-image headers plus an index through --output
+        i32                      Runs {1};        // only the last run is measured, earlier ones fill the output folder
+    };
+
+    std::vector<mode> const modes {
+        {.Name = "keep", .Args = {}},
+        {.Name = "auto", .Args = {"-f", "auto"}},
+        {.Name = "r8", .Args = {"-f", "r8"}},
+        {.Name = "rgb565", .Args = {"-f", "rgb565"}},
+        {.Name = "rgba4444", .Args = {"-f", "rgba4444"}},
+        {.Name = "indexed", .Args = {"-f", "indexed"}, .Palette = true},
+        {.Name = "bc1", .Args = {"-f", "bc1"}},
+        {.Name = "bc3", .Args = {"-f", "bc3"}},
+        {.Name = "bc7", .Args = {"-f", "bc7"}},
+        {.Name = "etc2", .Args = {"-f", "etc2"}},
+        {.Name = "keep+mips", .Args = {"--mips"}},
+        {.Name = "bc1+mips", .Args = {"-f", "bc1", "--mips"}},
+        {.Name = "atlas", .Args = {"--atlas"}, .Atlas = true},
+        {.Name = "atlas+bc1", .Args = {"--atlas", "-f", "bc1"}, .Atlas = true},
+        {.Name = "output", .Args = {}, .Folder = true},
+        {.Name = "output+incremental", .Args = {}, .Folder = true, .Runs = 2},
+        {.Name = "atlas+output", .Args = {"--atlas"}, .Atlas = true, .Folder = true},
+    };
+
+    std::cout << "size,mode,tool_ms,tool_peak_kib,header_bytes,compile_ms,compile_peak_kib\n";
+
+    for (i32 size {64}; size <= maxSize; size *= 2) {
+        fs::path const imgDir {workDir / std::format("img{}", size)};
+        fs::create_directories(imgDir);
+        fs::path const atlasDir {workDir / std::format("atlas{}", size)};
+        fs::create_directories(atlasDir);
+        fs::path const paletteDir {workDir / std::format("palette{}", size)};
+        fs::create_directories(paletteDir);
+        if (!make_image(size).save((imgDir / "bench_image.png").string())
+            || !make_image(size, true).save((paletteDir / "bench_image.png").string())) {
+            std::cerr << "error saving image\n";
+            return 1;
+        }
+        for (i32 i {0}; i < 4; ++i) {
+            if (!make_image(size / 2).save((atlasDir / std::format("bench_tile{}.png", i)).string())) {
+                std::cerr << "error saving image\n";
+                return 1;
+            }
+        }
+
+        for (auto const& mode : modes) {
+            fs::path const header {workDir / std::format("bench_{}_{}.hpp", size, mode.Name)};
+            fs::path const outDir {workDir / std::format("bench_{}_{}", size, mode.Name)};
+            fs::path const source {workDir / std::format("bench_{}_{}.cpp", size, mode.Name)};
+            fs::path const object {workDir / std::format("bench_{}_{}.o", size, mode.Name)};
+
+            std::vector<std::string> toolArgs {exe, (mode.Atlas ? atlasDir : mode.Palette ? paletteDir : imgDir).string()};
+            toolArgs.insert(toolArgs.end(), mode.Args.begin(), mode.Args.end());
+            if (mode.Folder) {
+                fs::remove_all(outDir);
+                toolArgs.insert(toolArgs.end(), {"-o", outDir.string()});
+            }
+
+            process_result tool;
+            for (i32 run {0}; run < mode.Runs; ++run) {
+                tool = run_process(toolArgs, mode.Folder ? workDir / "tool.log" : header);
+                if (tool.ExitCode != 0) { break; }
+            }
+            if (tool.ExitCode != 0) {
+                std::cerr << std::format("png2array failed for {} {}\n", size, mode.Name);
+                continue;
+            }
+
+            // atlas folders hold the atlas header alone, image folders an index of per-image headers
+            std::string const symbol {mode.Atlas ? "atlas" : "bench_image"};
+            fs::path const    output {mode.Folder ? outDir : header};
+            fs::path const    include {mode.Folder ? outDir / (mode.Atlas ? "atlas.hpp" : "png2array.hpp") : header};
+            std::ofstream {source} << "#include \"" << include.string() << "\"\n"
+                                   << "auto bench_size() -> unsigned { return " << symbol << "_info.SizeInBytes + " << symbol << "[0]; }\n";
+            auto const compile {run_process({cxx, "-std=c++20", "-c", source.string(), "-o", object.string()}, workDir / "compiler.log")};
+
+            std::cout << std::format("{},{},{:.1f},{},{},{:.1f},{}\n",
+                                     size, mode.Name, tool.Milliseconds, tool.PeakKiB, header_bytes(output),
+                                     compile.ExitCode == 0 ? compile.Milliseconds : -1.0, compile.PeakKiB);
+            std::cout.flush();
+        }
+    }
+
+    return 0;
+}
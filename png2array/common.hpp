@@ -0,0 +1,104 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <iostream>
+#include <tcob/tcob.hpp>
+
+using namespace tcob;
+namespace io = tcob::io;
+
+struct options {
+    std::string Format {"keep"};
+    i32         Threads {0};
+    bool        Mips {false};
+    bool        Atlas {false};
+    std::string AtlasName {"atlas"};
+    i32         AtlasGap {2};
+};
+
+// enumerators match png2array_format in the generated code
+enum class pixel_format : u8 {
+    RGB,
+    RGBA,
+    R8,       // luminance
+    RG8,      // luminance, alpha
+    RGB565,   // little endian
+    RGBA4444, // little endian
+    Indexed8, // with RGBA palette
+    BC1,
+    BC3,
+    BC7,
+    ETC2_RGB
+};
+
+struct pixel_data {
+    size_i              Size;
+    pixel_format        Format {pixel_format::RGBA};
+    std::span<u8 const> Source; // unconverted pixels, used if Buffer is empty
+    std::vector<u8>     Buffer;
+    std::vector<u8>     Palette;
+
+    auto data() const -> std::span<u8 const>;
+    auto bytes_per_pixel() const -> i32;
+    auto stride() const -> i32;
+    auto size_in_bytes() const -> i32;
+};
+
+struct atlas_region {
+    std::string Name;
+    rect_i      Bounds;
+};
+
+struct atlas {
+    gfx::image                Image;
+    std::vector<atlas_region> Regions;
+};
+
+// buffers generated code and hands it to the stream in fixed-size chunks
+class chunked_writer {
+public:
+    explicit chunked_writer(std::ostream& out);
+    ~chunked_writer();
+
+    chunked_writer(chunked_writer const&)                    = delete;
+    auto operator=(chunked_writer const&) -> chunked_writer& = delete;
+
+    void write(std::string_view str);
+    void write_hex(std::span<u8 const> buf);
+    void flush();
+
+private:
+    static constexpr usize CHUNK_SIZE {64 * 1024};
+
+    std::ostream&     _out;
+    std::vector<char> _buffer;
+    usize             _hexCount {0};
+};
+
+constexpr u64 FNV_OFFSET {0xcbf29ce484222325};
+
+auto hash_bytes(std::span<u8 const> buf, u64 hash = FNV_OFFSET) -> u64;
+auto hash_options(options const& opts) -> u64;
+
+auto get_format_name(pixel_format format) -> std::string;
+auto parse_format(std::string const& name) -> std::optional<pixel_format>;
+auto reduce_format(gfx::image const& img, options const& opts) -> std::optional<pixel_data>;
+
+auto build_mip_chain(gfx::image const& img) -> std::vector<gfx::image>;
+
+auto is_block_format(pixel_format format) -> bool;
+auto compress_blocks(gfx::image const& img, pixel_format format, i32 threads) -> pixel_data;
+auto decompress_blocks(pixel_data const& pixels) -> std::vector<u8>;
+
+auto preamble() -> std::string;
+auto convert(std::string const& srcFile, options const& opts, std::ostream& out) -> bool;
+auto convert_atlas(atlas const& atlas, options const& opts, std::ostream& out) -> bool;
+
+auto write_folder(std::vector<std::string> const& files, std::string const& outFolder, options const& opts) -> int;
+auto write_atlas_folder(std::vector<std::string> const& files, std::string const& outFolder, options const& opts) -> int;
+
+auto pack_atlas(std::vector<std::string> const& files, i32 gap) -> std::optional<atlas>;
@@ -0,0 +1,683 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "../shared/parallel.hpp"
+#include "common.hpp"
+
+namespace {
+
+using rgba  = std::array<i32, 4>;
+using block = std::array<rgba, 16>; // row-major 4x4
+using vec4  = std::array<f32, 4>;
+
+auto fetch_block(std::span<u8 const> buf, size_i size, i32 bpp, i32 bx, i32 by) -> block
+{
+    block retValue {};
+    for (i32 y {0}; y < 4; ++y) {
+        // edge pixels are repeated for partial blocks
+        i32 const sy {std::min((by * 4) + y, size.Height - 1)};
+        for (i32 x {0}; x < 4; ++x) {
+            i32 const sx {std::min((bx * 4) + x, size.Width - 1)};
+            u8 const* p {buf.data() + ((static_cast<isize>(sy) * size.Width) + sx) * bpp};
+            retValue[(y * 4) + x] = {p[0], p[1], p[2], bpp == 4 ? p[3] : 255};
+        }
+    }
+    return retValue;
+}
+
+auto dist_sq(rgba const& a, rgba const& b, i32 channels) -> i32
+{
+    i32 retValue {0};
+    for (i32 c {0}; c < channels; ++c) {
+        i32 const d {a[c] - b[c]};
+        retValue += d * d;
+    }
+    return retValue;
+}
+
+// extremes of the block along its principal axis
+auto principal_endpoints(block const& blk, i32 channels) -> std::pair<vec4, vec4>
+{
+    vec4 mean {};
+    for (auto const& p : blk) {
+        for (i32 c {0}; c < channels; ++c) { mean[c] += static_cast<f32>(p[c]) / 16.0f; }
+    }
+
+    std::array<std::array<f32, 4>, 4> cov {};
+    for (auto const& p : blk) {
+        for (i32 i {0}; i < channels; ++i) {
+            for (i32 j {0}; j < channels; ++j) {
+                cov[i][j] += (static_cast<f32>(p[i]) - mean[i]) * (static_cast<f32>(p[j]) - mean[j]);
+            }
+        }
+    }
+
+    // power iteration
+    vec4 axis {1.0f, 1.0f, 1.0f, channels == 4 ? 1.0f : 0.0f};
+    for (i32 iter {0}; iter < 8; ++iter) {
+        vec4 next {};
+        f32  len {0.0f};
+        for (i32 i {0}; i < channels; ++i) {
+            for (i32 j {0}; j < channels; ++j) { next[i] += cov[i][j] * axis[j]; }
+            len = std::max(len, std::abs(next[i]));
+        }
+        if (len <= 0.0f) {
+            return {mean, mean};
+        }
+        for (i32 i {0}; i < channels; ++i) { axis[i] = next[i] / len; }
+    }
+
+    f32 minT {std::numeric_limits<f32>::max()};
+    f32 maxT {std::numeric_limits<f32>::lowest()};
+    for (auto const& p : blk) {
+        f32 t {0.0f};
+        for (i32 c {0}; c < channels; ++c) { t += (static_cast<f32>(p[c]) - mean[c]) * axis[c]; }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    f32 lenSq {0.0f};
+    for (i32 c {0}; c < channels; ++c) { lenSq += axis[c] * axis[c]; }
+
+    vec4 lo {mean};
+    vec4 hi {mean};
+    for (i32 c {0}; c < channels; ++c) {
+        lo[c] += axis[c] * minT / lenSq;
+        hi[c] += axis[c] * maxT / lenSq;
+    }
+    return {lo, hi};
+}
+
+// least squares endpoints for the given index weights (w = weight of the second endpoint)
+auto fit_endpoints(block const& blk, std::span<f32 const, 16> w, i32 channels) -> std::optional<std::pair<vec4, vec4>>
+{
+    f32  aa {0}, bb {0}, ab {0};
+    vec4 ax {}, bx {};
+    for (usize i {0}; i < 16; ++i) {
+        f32 const b {w[i]};
+        f32 const a {1.0f - b};
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (i32 c {0}; c < channels; ++c) {
+            ax[c] += a * static_cast<f32>(blk[i][c]);
+            bx[c] += b * static_cast<f32>(blk[i][c]);
+        }
+    }
+
+    f32 const det {(aa * bb) - (ab * ab)};
+    if (std::abs(det) < 1e-6f) {
+        return std::nullopt;
+    }
+
+    vec4 e0 {}, e1 {};
+    for (i32 c {0}; c < channels; ++c) {
+        e0[c] = std::clamp(((ax[c] * bb) - (bx[c] * ab)) / det, 0.0f, 255.0f);
+        e1[c] = std::clamp(((bx[c] * aa) - (ax[c] * ab)) / det, 0.0f, 255.0f);
+    }
+    return std::pair {e0, e1};
+}
+
+////////////////////////////////////////////////////////////
+// BC1
+
+auto to_565(vec4 const& c) -> u16
+{
+    auto const q {[](f32 v, i32 max) { return static_cast<u32>(std::lround(std::clamp(v, 0.0f, 255.0f) * static_cast<f32>(max) / 255.0f)); }};
+    return static_cast<u16>((q(c[0], 31) << 11) | (q(c[1], 63) << 5) | q(c[2], 31));
+}
+
+auto from_565(u32 v) -> rgba
+{
+    u32 const r {(v >> 11) & 31}, g {(v >> 5) & 63}, b {v & 31};
+    return {static_cast<i32>((r << 3) | (r >> 2)), static_cast<i32>((g << 2) | (g >> 4)), static_cast<i32>((b << 3) | (b >> 2)), 255};
+}
+
+auto bc1_palette(u16 c0, u16 c1) -> std::array<rgba, 4>
+{
+    rgba const p0 {from_565(c0)};
+    rgba const p1 {from_565(c1)};
+    std::array<rgba, 4> retValue {p0, p1, {}, {}};
+    for (i32 c {0}; c < 4; ++c) {
+        retValue[2][c] = ((2 * p0[c]) + p1[c]) / 3;
+        retValue[3][c] = (p0[c] + (2 * p1[c])) / 3;
+    }
+    return retValue;
+}
+
+struct bc1_result {
+    u16 C0 {0};
+    u16 C1 {0};
+    u32 Indices {0};
+    i32 Error {std::numeric_limits<i32>::max()};
+};
+
+auto bc1_assign(block const& blk, u16 c0, u16 c1) -> bc1_result
+{
+    // four color mode needs c0 > c1
+    if (c0 < c1) { std::swap(c0, c1); }
+
+    bc1_result retValue {.C0 = c0, .C1 = c1, .Indices = 0, .Error = 0};
+    auto const pal {bc1_palette(c0, c1)};
+    for (u32 i {0}; i < 16; ++i) {
+        u32 best {0};
+        i32 bestDist {std::numeric_limits<i32>::max()};
+        for (u32 j {0}; j < (c0 == c1 ? 1u : 4u); ++j) {
+            if (i32 const d {dist_sq(blk[i], pal[j], 3)}; d < bestDist) {
+                bestDist = d;
+                best     = j;
+            }
+        }
+        retValue.Indices |= best << (i * 2);
+        retValue.Error += bestDist;
+    }
+    return retValue;
+}
+
+void encode_bc1(block const& blk, u8* dst)
+{
+    auto const [lo, hi] {principal_endpoints(blk, 3)};
+    bc1_result best {bc1_assign(blk, to_565(hi), to_565(lo))};
+
+    for (i32 iter {0}; iter < 2 && best.Error > 0 && best.C0 != best.C1; ++iter) {
+        static constexpr std::array<f32, 4> WEIGHTS {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+        std::array<f32, 16> w {};
+        for (u32 i {0}; i < 16; ++i) { w[i] = WEIGHTS[(best.Indices >> (i * 2)) & 3]; }
+        auto const fit {fit_endpoints(blk, w, 3)};
+        if (!fit) { break; }
+
+        bc1_result const next {bc1_assign(blk, to_565(fit->first), to_565(fit->second))};
+        if (next.Error >= best.Error) { break; }
+        best = next;
+    }
+
+    dst[0] = static_cast<u8>(best.C0 & 0xFF);
+    dst[1] = static_cast<u8>(best.C0 >> 8);
+    dst[2] = static_cast<u8>(best.C1 & 0xFF);
+    dst[3] = static_cast<u8>(best.C1 >> 8);
+    for (u32 i {0}; i < 4; ++i) { dst[4 + i] = static_cast<u8>(best.Indices >> (i * 8)); }
+}
+
+void decode_bc1(u8 const* src, block& blk)
+{
+    u16 const c0 {static_cast<u16>(src[0] | (src[1] << 8))};
+    u16 const c1 {static_cast<u16>(src[2] | (src[3] << 8))};
+    u32 const indices {static_cast<u32>(src[4] | (src[5] << 8) | (src[6] << 16) | (src[7] << 24))};
+    auto      pal {bc1_palette(c0, c1)};
+    if (c0 <= c1) {
+        // three color mode, only produced by other encoders
+        for (i32 c {0}; c < 3; ++c) { pal[2][c] = (pal[0][c] + pal[1][c]) / 2; }
+        pal[3] = {0, 0, 0, 0};
+    }
+    for (u32 i {0}; i < 16; ++i) {
+        auto const a {blk[i][3]};
+        blk[i]    = pal[(indices >> (i * 2)) & 3];
+        blk[i][3] = a;
+    }
+}
+
+////////////////////////////////////////////////////////////
+// BC3 (BC4 alpha + BC1 color)
+
+auto bc4_palette(i32 a0, i32 a1) -> std::array<i32, 8>
+{
+    std::array<i32, 8> retValue {a0, a1};
+    for (i32 i {2}; i < 8; ++i) { retValue[i] = (((8 - i) * a0) + ((i - 1) * a1)) / 7; }
+    return retValue;
+}
+
+void encode_bc3(block const& blk, u8* dst)
+{
+    i32 a0 {0}, a1 {255};
+    for (auto const& p : blk) {
+        a0 = std::max(a0, p[3]);
+        a1 = std::min(a1, p[3]);
+    }
+
+    dst[0] = static_cast<u8>(a0);
+    dst[1] = static_cast<u8>(a1);
+
+    u64 indices {0};
+    if (a0 != a1) {
+        auto const pal {bc4_palette(a0, a1)};
+        for (u32 i {0}; i < 16; ++i) {
+            u64 best {0};
+            for (u64 j {1}; j < 8; ++j) {
+                if (std::abs(pal[j] - blk[i][3]) < std::abs(pal[best] - blk[i][3])) { best = j; }
+            }
+            indices |= best << (i * 3);
+        }
+    }
+    for (u32 i {0}; i < 6; ++i) { dst[2 + i] = static_cast<u8>(indices >> (i * 8)); }
+
+    encode_bc1(blk, dst + 8);
+}
+
+void decode_bc3(u8 const* src, block& blk)
+{
+    decode_bc1(src + 8, blk);
+
+    i32 const          a0 {src[0]};
+    i32 const          a1 {src[1]};
+    std::array<i32, 8> pal {bc4_palette(a0, a1)};
+    if (a0 <= a1) {
+        // six value mode, only produced by other encoders
+        for (i32 i {2}; i < 6; ++i) { pal[i] = (((6 - i) * a0) + ((i - 1) * a1)) / 5; }
+        pal[6] = 0;
+        pal[7] = 255;
+    }
+
+    u64 indices {0};
+    for (u32 i {0}; i < 6; ++i) { indices |= static_cast<u64>(src[2 + i]) << (i * 8); }
+    for (u32 i {0}; i < 16; ++i) { blk[i][3] = pal[(indices >> (i * 3)) & 7]; }
+}
+
+////////////////////////////////////////////////////////////
+// BC7, mode 6 only: one subset, RGBA 7.7.7.7 endpoints with p-bit, 4 bit indices
+
+constexpr std::array<i32, 16> BC7_WEIGHTS {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct bc7_endpoint {
+    std::array<i32, 4> Value {}; // 7 bit
+    i32                PBit {0};
+
+    auto decode() const -> rgba
+    {
+        return {(Value[0] << 1) | PBit, (Value[1] << 1) | PBit, (Value[2] << 1) | PBit, (Value[3] << 1) | PBit};
+    }
+};
+
+auto bc7_quantize(vec4 const& v) -> bc7_endpoint
+{
+    bc7_endpoint best;
+    f32          bestErr {std::numeric_limits<f32>::max()};
+    for (i32 p {0}; p < 2; ++p) {
+        bc7_endpoint e {.Value = {}, .PBit = p};
+        f32          err {0.0f};
+        for (i32 c {0}; c < 4; ++c) {
+            e.Value[c]   = std::clamp(static_cast<i32>(std::lround((v[c] - static_cast<f32>(p)) / 2.0f)), 0, 127);
+            f32 const d {static_cast<f32>((e.Value[c] << 1) | p) - v[c]};
+            err += d * d;
+        }
+        if (err < bestErr) {
+            bestErr = err;
+            best    = e;
+        }
+    }
+    return best;
+}
+
+auto bc7_palette(bc7_endpoint const& e0, bc7_endpoint const& e1) -> std::array<rgba, 16>
+{
+    rgba const           p0 {e0.decode()};
+    rgba const           p1 {e1.decode()};
+    std::array<rgba, 16> retValue {};
+    for (usize i {0}; i < 16; ++i) {
+        for (i32 c {0}; c < 4; ++c) {
+            retValue[i][c] = (((64 - BC7_WEIGHTS[i]) * p0[c]) + (BC7_WEIGHTS[i] * p1[c]) + 32) >> 6;
+        }
+    }
+    return retValue;
+}
+
+struct bc7_result {
+    bc7_endpoint          E0;
+    bc7_endpoint          E1;
+    std::array<u8, 16>    Indices {};
+    i32                   Error {std::numeric_limits<i32>::max()};
+};
+
+auto bc7_assign(block const& blk, bc7_endpoint const& e0, bc7_endpoint const& e1) -> bc7_result
+{
+    bc7_result retValue {.E0 = e0, .E1 = e1, .Indices = {}, .Error = 0};
+    auto const pal {bc7_palette(e0, e1)};
+    for (usize i {0}; i < 16; ++i) {
+        i32 bestDist {std::numeric_limits<i32>::max()};
+        for (u8 j {0}; j < 16; ++j) {
+            if (i32 const d {dist_sq(blk[i], pal[j], 4)}; d < bestDist) {
+                bestDist           = d;
+                retValue.Indices[i] = j;
+            }
+        }
+        retValue.Error += bestDist;
+    }
+
+    // the anchor index is stored without its top bit
+    if (retValue.Indices[0] >= 8) {
+        std::swap(retValue.E0, retValue.E1);
+        for (auto& idx : retValue.Indices) { idx = static_cast<u8>(15 - idx); }
+    }
+    return retValue;
+}
+
+class bit_writer {
+public:
+    explicit bit_writer(u8* dst)
+        : _dst {dst}
+    {
+    }
+
+    void write(u32 value, i32 bits)
+    {
+        for (i32 i {0}; i < bits; ++i, ++_pos) {
+            if ((value >> i) & 1) { _dst[_pos / 8] |= static_cast<u8>(1 << (_pos % 8)); }
+        }
+    }
+
+private:
+    u8* _dst;
+    i32 _pos {0};
+};
+
+class bit_reader {
+public:
+    explicit bit_reader(u8 const* src)
+        : _src {src}
+    {
+    }
+
+    auto read(i32 bits) -> u32
+    {
+        u32 retValue {0};
+        for (i32 i {0}; i < bits; ++i, ++_pos) {
+            retValue |= static_cast<u32>((_src[_pos / 8] >> (_pos % 8)) & 1) << i;
+        }
+        return retValue;
+    }
+
+private:
+    u8 const* _src;
+    i32       _pos {0};
+};
+
+void encode_bc7(block const& blk, u8* dst)
+{
+    auto const [lo, hi] {principal_endpoints(blk, 4)};
+    bc7_result best {bc7_assign(blk, bc7_quantize(lo), bc7_quantize(hi))};
+
+    for (i32 iter {0}; iter < 2 && best.Error > 0; ++iter) {
+        std::array<f32, 16> w {};
+        for (usize i {0}; i < 16; ++i) { w[i] = static_cast<f32>(BC7_WEIGHTS[best.Indices[i]]) / 64.0f; }
+        auto const fit {fit_endpoints(blk, w, 4)};
+        if (!fit) { break; }
+
+        bc7_result const next {bc7_assign(blk, bc7_quantize(fit->first), bc7_quantize(fit->second))};
+        if (next.Error >= best.Error) { break; }
+        best = next;
+    }
+
+    std::fill_n(dst, 16, u8 {0});
+    bit_writer bits {dst};
+    bits.write(1 << 6, 7);
+    for (i32 c {0}; c < 4; ++c) {
+        bits.write(static_cast<u32>(best.E0.Value[c]), 7);
+        bits.write(static_cast<u32>(best.E1.Value[c]), 7);
+    }
+    bits.write(static_cast<u32>(best.E0.PBit), 1);
+    bits.write(static_cast<u32>(best.E1.PBit), 1);
+    for (usize i {0}; i < 16; ++i) { bits.write(best.Indices[i], i == 0 ? 3 : 4); }
+}
+
+void decode_bc7(u8 const* src, block& blk)
+{
+    bit_reader bits {src};
+    if (bits.read(7) != (1 << 6)) {
+        // not produced by this encoder
+        blk.fill({0, 0, 0, 0});
+        return;
+    }
+
+    bc7_endpoint e0, e1;
+    for (i32 c {0}; c < 4; ++c) {
+        e0.Value[c] = static_cast<i32>(bits.read(7));
+        e1.Value[c] = static_cast<i32>(bits.read(7));
+    }
+    e0.PBit = static_cast<i32>(bits.read(1));
+    e1.PBit = static_cast<i32>(bits.read(1));
+
+    auto const pal {bc7_palette(e0, e1)};
+    for (usize i {0}; i < 16; ++i) { blk[i] = pal[bits.read(i == 0 ? 3 : 4)]; }
+}
+
+////////////////////////////////////////////////////////////
+// ETC2 RGB8, using the ETC1 compatible individual and differential modes
+
+constexpr std::array<std::array<i32, 2>, 8> ETC_MODIFIERS {{{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}}};
+
+auto etc_modifier(i32 table, u32 idx) -> i32
+{
+    i32 const m {ETC_MODIFIERS[table][idx & 1]};
+    return idx >= 2 ? -m : m;
+}
+
+auto etc_apply(rgba const& base, i32 mod) -> rgba
+{
+    return {std::clamp(base[0] + mod, 0, 255), std::clamp(base[1] + mod, 0, 255), std::clamp(base[2] + mod, 0, 255), 255};
+}
+
+// pixels of subblock 0 or 1, as (x, y)
+auto etc_subblock(bool flip, i32 sub) -> std::array<point_i, 8>
+{
+    std::array<point_i, 8> retValue {};
+    for (i32 i {0}; i < 8; ++i) {
+        retValue[i] = flip ? point_i {i % 4, (sub * 2) + (i / 4)} : point_i {(sub * 2) + (i / 4), i % 4};
+    }
+    return retValue;
+}
+
+struct etc_subblock_result {
+    i32                Table {0};
+    std::array<u32, 8> Indices {};
+    i32                Error {std::numeric_limits<i32>::max()};
+};
+
+auto etc_fit_subblock(block const& blk, std::array<point_i, 8> const& pixels, rgba const& base) -> etc_subblock_result
+{
+    etc_subblock_result best;
+    for (i32 t {0}; t < 8; ++t) {
+        etc_subblock_result res {.Table = t, .Indices = {}, .Error = 0};
+        for (usize i {0}; i < 8; ++i) {
+            rgba const& px {blk[(pixels[i].Y * 4) + pixels[i].X]};
+            i32         bestDist {std::numeric_limits<i32>::max()};
+            for (u32 j {0}; j < 4; ++j) {
+                if (i32 const d {dist_sq(px, etc_apply(base, etc_modifier(t, j)), 3)}; d < bestDist) {
+                    bestDist       = d;
+                    res.Indices[i] = j;
+                }
+            }
+            res.Error += bestDist;
+        }
+        if (res.Error < best.Error) { best = res; }
+    }
+    return best;
+}
+
+void encode_etc2(block const& blk, u8* dst)
+{
+    u64 bestBits {0};
+    i32 bestError {std::numeric_limits<i32>::max()};
+
+    for (bool const flip : {false, true}) {
+        std::array<std::array<point_i, 8>, 2> const pixels {etc_subblock(flip, 0), etc_subblock(flip, 1)};
+
+        std::array<vec4, 2> avg {};
+        for (i32 s {0}; s < 2; ++s) {
+            for (auto const& p : pixels[s]) {
+                for (i32 c {0}; c < 3; ++c) { avg[s][c] += static_cast<f32>(blk[(p.Y * 4) + p.X][c]) / 8.0f; }
+            }
+        }
+
+        for (bool const diff : {true, false}) {
+            i32 const                    max {diff ? 31 : 15};
+            std::array<std::array<i32, 3>, 2> q {};
+            for (i32 s {0}; s < 2; ++s) {
+                for (i32 c {0}; c < 3; ++c) { q[s][c] = static_cast<i32>(std::lround(avg[s][c] * static_cast<f32>(max) / 255.0f)); }
+            }
+
+            if (diff) {
+                // delta has to fit into 3 bits, otherwise the block turns into an ETC2 T/H/planar block
+                bool fits {true};
+                for (i32 c {0}; c < 3; ++c) {
+                    q[1][c] = std::clamp(q[1][c], q[0][c] - 4, q[0][c] + 3);
+                    fits    = fits && q[1][c] >= 0 && q[1][c] <= 31;
+                }
+                if (!fits) { continue; }
+            }
+
+            std::array<rgba, 2> base {};
+            for (i32 s {0}; s < 2; ++s) {
+                for (i32 c {0}; c < 3; ++c) { base[s][c] = diff ? (q[s][c] << 3) | (q[s][c] >> 2) : (q[s][c] << 4) | q[s][c]; }
+            }
+
+            auto const r0 {etc_fit_subblock(blk, pixels[0], base[0])};
+            auto const r1 {etc_fit_subblock(blk, pixels[1], base[1])};
+            if (r0.Error + r1.Error >= bestError) { continue; }
+            bestError = r0.Error + r1.Error;
+
+            u64 bits {0};
+            for (i32 c {0}; c < 3; ++c) {
+                i32 const shift {56 - (c * 8)};
+                if (diff) {
+                    bits |= static_cast<u64>(q[0][c]) << (shift + 3);
+                    bits |= static_cast<u64>((q[1][c] - q[0][c]) & 7) << shift;
+                } else {
+                    bits |= static_cast<u64>(q[0][c]) << (shift + 4);
+                    bits |= static_cast<u64>(q[1][c]) << shift;
+                }
+            }
+            bits |= static_cast<u64>(r0.Table) << 37;
+            bits |= static_cast<u64>(r1.Table) << 34;
+            bits |= static_cast<u64>(diff ? 1 : 0) << 33;
+            bits |= static_cast<u64>(flip ? 1 : 0) << 32;
+            for (i32 s {0}; s < 2; ++s) {
+                auto const& res {s == 0 ? r0 : r1};
+                for (usize i {0}; i < 8; ++i) {
+                    i32 const j {(pixels[s][i].X * 4) + pixels[s][i].Y};
+                    bits |= static_cast<u64>(res.Indices[i] >> 1) << (16 + j);
+                    bits |= static_cast<u64>(res.Indices[i] & 1) << j;
+                }
+            }
+            bestBits = bits;
+        }
+    }
+
+    for (i32 i {0}; i < 8; ++i) { dst[i] = static_cast<u8>(bestBits >> (56 - (i * 8))); }
+}
+
+void decode_etc2(u8 const* src, block& blk)
+{
+    u64 bits {0};
+    for (i32 i {0}; i < 8; ++i) { bits = (bits << 8) | src[i]; }
+
+    bool const          diff {((bits >> 33) & 1) != 0};
+    bool const          flip {((bits >> 32) & 1) != 0};
+    std::array<rgba, 2> base {};
+    for (i32 c {0}; c < 3; ++c) {
+        i32 const shift {56 - (c * 8)};
+        if (diff) {
+            i32 const c0 {static_cast<i32>((bits >> (shift + 3)) & 31)};
+            i32       d {static_cast<i32>((bits >> shift) & 7)};
+            if (d >= 4) { d -= 8; }
+            i32 const c1 {c0 + d}; // T/H/planar blocks are never produced by this encoder
+            base[0][c] = (c0 << 3) | (c0 >> 2);
+            base[1][c] = (c1 << 3) | (c1 >> 2);
+        } else {
+            i32 const c0 {static_cast<i32>((bits >> (shift + 4)) & 15)};
+            i32 const c1 {static_cast<i32>((bits >> shift) & 15)};
+            base[0][c] = (c0 << 4) | c0;
+            base[1][c] = (c1 << 4) | c1;
+        }
+    }
+
+    std::array<i32, 2> const tables {static_cast<i32>((bits >> 37) & 7), static_cast<i32>((bits >> 34) & 7)};
+    for (i32 s {0}; s < 2; ++s) {
+        for (auto const& p : etc_subblock(flip, s)) {
+            i32 const j {(p.X * 4) + p.Y};
+            u32 const idx {static_cast<u32>((((bits >> (16 + j)) & 1) << 1) | ((bits >> j) & 1))};
+            blk[(p.Y * 4) + p.X] = etc_apply(base[s], etc_modifier(tables[s], idx));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+
+auto block_bytes(pixel_format format) -> i32
+{
+    return format == pixel_format::BC1 || format == pixel_format::ETC2_RGB ? 8 : 16;
+}
+
+}
+
+auto is_block_format(pixel_format format) -> bool
+{
+    return format == pixel_format::BC1 || format == pixel_format::BC3 || format == pixel_format::BC7 || format == pixel_format::ETC2_RGB;
+}
+
+auto compress_blocks(gfx::image const& img, pixel_format format, i32 threads) -> pixel_data
+{
+    auto const& info {img.info()};
+    auto const  buf {img.data()};
+    i32 const   bpp {info.bytes_per_pixel()};
+
+    pixel_data retValue {.Size = info.Size, .Format = format, .Source = {}, .Buffer = {}, .Palette = {}};
+    retValue.Buffer.resize(static_cast<usize>(retValue.size_in_bytes()));
+
+    i32 const blocksX {(info.Size.Width + 3) / 4};
+    i32 const blocksY {(info.Size.Height + 3) / 4};
+    i32 const size {block_bytes(format)};
+    u8*       dst {retValue.Buffer.data()};
+
+    parallel_for(blocksY, threads, [&](isize begin, isize end) {
+        for (i32 by {static_cast<i32>(begin)}; by < end; ++by) {
+            for (i32 bx {0}; bx < blocksX; ++bx) {
+                block const blk {fetch_block(buf, info.Size, bpp, bx, by)};
+                u8*         out {dst + ((static_cast<isize>(by) * blocksX) + bx) * size};
+                switch (format) {
+                case pixel_format::BC1: encode_bc1(blk, out); break;
+                case pixel_format::BC3: encode_bc3(blk, out); break;
+                case pixel_format::BC7: encode_bc7(blk, out); break;
+                case pixel_format::ETC2_RGB: encode_etc2(blk, out); break;
+                default: break;
+                }
+            }
+        }
+    });
+
+    return retValue;
+}
+
+auto decompress_blocks(pixel_data const& pixels) -> std::vector<u8>
+{
+    size_i const size {pixels.Size};
+    i32 const    blocksX {(size.Width + 3) / 4};
+    i32 const    blocksY {(size.Height + 3) / 4};
+    i32 const    blkSize {block_bytes(pixels.Format)};
+    auto const   src {pixels.data()};
+
+    std::vector<u8> retValue(static_cast<usize>(size.Width) * size.Height * 4);
+    for (i32 by {0}; by < blocksY; ++by) {
+        for (i32 bx {0}; bx < blocksX; ++bx) {
+            u8 const* in {src.data() + ((static_cast<isize>(by) * blocksX) + bx) * blkSize};
+            block     blk {};
+            blk.fill({0, 0, 0, 255});
+            switch (pixels.Format) {
+            case pixel_format::BC1: decode_bc1(in, blk); break;
+            case pixel_format::BC3: decode_bc3(in, blk); break;
+            case pixel_format::BC7: decode_bc7(in, blk); break;
+            case pixel_format::ETC2_RGB: decode_etc2(in, blk); break;
+            default: break;
+            }
+
+            for (i32 y {0}; y < 4 && (by * 4) + y < size.Height; ++y) {
+                for (i32 x {0}; x < 4 && (bx * 4) + x < size.Width; ++x) {
+                    u8* p {retValue.data() + (((static_cast<isize>(by) * 4 + y) * size.Width) + (bx * 4) + x) * 4};
+                    for (i32 c {0}; c < 4; ++c) { p[c] = static_cast<u8>(blk[(y * 4) + x][c]); }
+                }
+            }
+        }
+    }
+    return retValue;
+}
@@ -0,0 +1,290 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+// FNV-1a, 64 bit
+auto hash_bytes(std::span<u8 const> buf, u64 hash) -> u64
+{
+    for (u8 const b : buf) {
+        hash ^= b;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+auto hash_options(options const& opts) -> u64
+{
+    // everything that changes the generated code
+    std::string const key {std::format("png2array 3;format={};mips={};atlas={};gap={}", opts.Format, opts.Mips, opts.Atlas, opts.AtlasGap)};
+    return hash_bytes({reinterpret_cast<u8 const*>(key.data()), key.size()});
+}
+
+auto preamble() -> std::string
+{
+    return R"(#include <array>
+#include <cstdint>
+#include <string_view>
+
+#ifndef PNG2ARRAY_TYPES
+#define PNG2ARRAY_TYPES
+// RGB and RGBA match tcob::gfx::image::format
+enum class png2array_format : uint8_t {
+    RGB,
+    RGBA,
+    R8,       // luminance
+    RG8,      // luminance, alpha
+    RGB565,   // little endian
+    RGBA4444, // little endian
+    Indexed8, // see PaletteSize
+    BC1,      // 4x4 blocks, Stride is per block row, BytesPerPixel is 0
+    BC3,
+    BC7,
+    ETC2_RGB
+};
+
+struct png2array_image_info {
+    uint32_t         Width;
+    uint32_t         Height;
+    png2array_format Format;
+    uint32_t         BytesPerPixel;
+    uint32_t         Stride;
+    uint32_t         SizeInBytes;
+    uint32_t         PaletteSize; // RGBA entries in <name>_palette
+    uint32_t         MipLevels;   // see <name>_mips if greater than 1
+    uint64_t         Hash;        // FNV-1a of the pixel data
+};
+
+struct png2array_mip_level {
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Stride;
+    uint32_t Offset; // into the pixel array
+    uint32_t SizeInBytes;
+};
+
+struct png2array_rect {
+    float X;
+    float Y;
+    float Width;
+    float Height;
+};
+
+// same shape as tcob::gfx::texture_region
+struct png2array_texture_region {
+    std::string_view Name;
+    png2array_rect   UVRect;
+    uint32_t         Level;
+};
+#endif
+
+)";
+}
+
+chunked_writer::chunked_writer(std::ostream& out)
+    : _out {out}
+{
+    _buffer.reserve(CHUNK_SIZE);
+}
+
+chunked_writer::~chunked_writer()
+{
+    flush();
+}
+
+void chunked_writer::write(std::string_view str)
+{
+    _hexCount = 0;
+    if (_buffer.size() + str.size() > CHUNK_SIZE) {
+        flush();
+    }
+    if (str.size() > CHUNK_SIZE) {
+        _out.write(str.data(), static_cast<std::streamsize>(str.size()));
+        return;
+    }
+    _buffer.insert(_buffer.end(), str.begin(), str.end());
+}
+
+void chunked_writer::write_hex(std::span<u8 const> buf)
+{
+    static constexpr std::string_view DIGITS {"0123456789abcdef"};
+
+    // continues the current array until the next write()
+    for (u8 const b : buf) {
+        // longest entry is ", \n 0xff"
+        if (_buffer.size() + 8 > CHUNK_SIZE) {
+            flush();
+        }
+        if (_hexCount > 0) {
+            _buffer.push_back(',');
+            _buffer.push_back(' ');
+        }
+        if (_hexCount % 16 == 0) {
+            _buffer.push_back('\n');
+            _buffer.push_back(' ');
+        }
+        _buffer.push_back('0');
+        _buffer.push_back('x');
+        _buffer.push_back(DIGITS[b >> 4]);
+        _buffer.push_back(DIGITS[b & 0xF]);
+        ++_hexCount;
+    }
+}
+
+void chunked_writer::flush()
+{
+    if (!_buffer.empty()) {
+        _out.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+        _buffer.clear();
+    }
+}
+
+static void write_image(chunked_writer& out, std::string const& name, std::span<pixel_data const> levels)
+{
+    pixel_data const& img {levels.front()};
+    auto const        paletteSize {img.Palette.size() / 4};
+
+    i32 size {0};
+    u64 hash {FNV_OFFSET};
+    for (auto const& level : levels) {
+        size += level.size_in_bytes();
+        hash = hash_bytes(level.data(), hash);
+    }
+
+    out.write(std::format(
+        "constexpr png2array_image_info {}_info {{\n"
+        "    .Width = {},\n"
+        "    .Height = {},\n"
+        "    .Format = png2array_format::{},\n"
+        "    .BytesPerPixel = {},\n"
+        "    .Stride = {},\n"
+        "    .SizeInBytes = {},\n"
+        "    .PaletteSize = {},\n"
+        "    .MipLevels = {},\n"
+        "    .Hash = 0x{:x}}};\n",
+        name, img.Size.Width, img.Size.Height, get_format_name(img.Format),
+        img.bytes_per_pixel(), img.stride(), size, paletteSize, levels.size(), hash));
+
+    if (paletteSize > 0) {
+        out.write(std::format("constexpr std::array<uint8_t, {}> {}_palette {{", img.Palette.size(), name));
+        out.write_hex(img.Palette);
+        out.write(" };\n");
+    }
+
+    if (levels.size() > 1) {
+        out.write(std::format("constexpr std::array<png2array_mip_level, {}> {}_mips {{{{\n", levels.size(), name));
+        i32 offset {0};
+        for (auto const& level : levels) {
+            out.write(std::format("    {{.Width = {}, .Height = {}, .Stride = {}, .Offset = {}, .SizeInBytes = {}}},\n",
+                                  level.Size.Width, level.Size.Height, level.stride(), offset, level.size_in_bytes()));
+            offset += level.size_in_bytes();
+        }
+        out.write("}};\n");
+    }
+
+    out.write(std::format("constexpr std::array<uint8_t, {}> {} {{", size, name));
+    for (auto const& level : levels) {
+        out.write_hex(level.data().subspan(0, static_cast<usize>(level.size_in_bytes())));
+    }
+    out.write(" };\n");
+}
+
+static auto reduce_levels(std::span<gfx::image const> images, options const& opts) -> std::optional<std::vector<pixel_data>>
+{
+    std::vector<pixel_data> retValue;
+    for (auto const& img : images) {
+        auto level {reduce_format(img, opts)};
+        if (!level) {
+            return std::nullopt;
+        }
+        retValue.push_back(std::move(*level));
+    }
+
+    // every level has to share format and palette
+    bool const consistent {std::ranges::all_of(retValue, [&](pixel_data const& level) {
+        return level.Format == retValue.front().Format && level.Palette.empty();
+    })};
+    if (consistent) {
+        return retValue;
+    }
+    if (opts.Format == "auto") {
+        options keep {opts};
+        keep.Format = "keep";
+        return reduce_levels(images, keep);
+    }
+
+    std::cerr << "format " << opts.Format << " can't be used for mipmaps\n";
+    return std::nullopt;
+}
+
+static auto write_reduced(chunked_writer& out, std::string const& name, gfx::image const& img, options const& opts) -> bool
+{
+    std::vector<pixel_data> levels;
+    std::vector<gfx::image> mips;
+    if (opts.Mips) {
+        mips = build_mip_chain(img);
+        auto reduced {reduce_levels(mips, opts)};
+        if (!reduced) {
+            return false;
+        }
+        levels = std::move(*reduced);
+    } else {
+        auto level {reduce_format(img, opts)};
+        if (!level) {
+            return false;
+        }
+        levels.push_back(std::move(*level));
+    }
+
+    auto const& info {img.info()};
+    auto const  srcFormat {info.Format == gfx::image::format::RGBA ? pixel_format::RGBA : pixel_format::RGB};
+    if (levels.front().Format != srcFormat) {
+        i32 const oldSize {info.size_in_bytes()};
+        i32 const newSize {levels.front().size_in_bytes() + static_cast<i32>(levels.front().Palette.size())};
+        std::cerr << std::format("{}: {} -> {}, {} -> {} bytes ({:.1f}% saved)\n",
+                                 name, get_format_name(srcFormat), get_format_name(levels.front().Format),
+                                 oldSize, newSize, 100.0 * (oldSize - newSize) / oldSize);
+    }
+
+    write_image(out, name, levels);
+    return true;
+}
+
+auto convert(std::string const& srcFile, options const& opts, std::ostream& out) -> bool
+{
+    if (auto const img {gfx::image::Load(srcFile)}) {
+        chunked_writer writer {out};
+        return write_reduced(writer, io::get_stem(srcFile), *img, opts);
+    }
+
+    std::cerr << "error loading image: " << srcFile << "\n";
+    return false;
+}
+
+auto convert_atlas(atlas const& atlas, options const& opts, std::ostream& out) -> bool
+{
+    std::string const& name {opts.AtlasName};
+
+    chunked_writer writer {out};
+    if (!write_reduced(writer, name, atlas.Image, opts)) {
+        return false;
+    }
+
+    auto const  atlasSize {atlas.Image.info().Size};
+    f32 const   width {static_cast<f32>(atlasSize.Width)};
+    f32 const   height {static_cast<f32>(atlasSize.Height)};
+    usize const count {atlas.Regions.size()};
+
+    writer.write(std::format("constexpr std::array<png2array_texture_region, {}> {}_regions {{{{\n", count, name));
+    for (auto const& region : atlas.Regions) {
+        auto const& b {region.Bounds};
+        writer.write(std::format("    {{.Name = \"{}\", .UVRect = {{{}, {}, {}, {}}}, .Level = 0}},\n",
+                                 region.Name,
+                                 static_cast<f32>(b.left()) / width, static_cast<f32>(b.top()) / height,
+                                 static_cast<f32>(b.width()) / width, static_cast<f32>(b.height()) / height));
+    }
+    writer.write("}};\n");
+    return true;
+}
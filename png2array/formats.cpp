@@ -0,0 +1,313 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+#include <unordered_map>
+
+auto pixel_data::bytes_per_pixel() const -> i32
+{
+    switch (Format) {
+    case pixel_format::RGB: return 3;
+    case pixel_format::RGBA: return 4;
+    case pixel_format::R8: return 1;
+    case pixel_format::RG8: return 2;
+    case pixel_format::RGB565: return 2;
+    case pixel_format::RGBA4444: return 2;
+    case pixel_format::Indexed8: return 1;
+    case pixel_format::BC1:
+    case pixel_format::BC3:
+    case pixel_format::BC7:
+    case pixel_format::ETC2_RGB: return 0;
+    }
+    return 4;
+}
+
+auto pixel_data::data() const -> std::span<u8 const>
+{
+    return Buffer.empty() ? Source : std::span<u8 const> {Buffer};
+}
+
+// for block formats: bytes per row of 4x4 blocks
+auto pixel_data::stride() const -> i32
+{
+    switch (Format) {
+    case pixel_format::BC1:
+    case pixel_format::ETC2_RGB: return ((Size.Width + 3) / 4) * 8;
+    case pixel_format::BC3:
+    case pixel_format::BC7: return ((Size.Width + 3) / 4) * 16;
+    default: return Size.Width * bytes_per_pixel();
+    }
+}
+
+auto pixel_data::size_in_bytes() const -> i32
+{
+    return stride() * (is_block_format(Format) ? (Size.Height + 3) / 4 : Size.Height);
+}
+
+auto get_format_name(pixel_format format) -> std::string
+{
+    switch (format) {
+    case pixel_format::RGB: return "RGB";
+    case pixel_format::RGBA: return "RGBA";
+    case pixel_format::R8: return "R8";
+    case pixel_format::RG8: return "RG8";
+    case pixel_format::RGB565: return "RGB565";
+    case pixel_format::RGBA4444: return "RGBA4444";
+    case pixel_format::Indexed8: return "Indexed8";
+    case pixel_format::BC1: return "BC1";
+    case pixel_format::BC3: return "BC3";
+    case pixel_format::BC7: return "BC7";
+    case pixel_format::ETC2_RGB: return "ETC2_RGB";
+    }
+    return "RGBA";
+}
+
+auto parse_format(std::string const& name) -> std::optional<pixel_format>
+{
+    static std::unordered_map<std::string, pixel_format> const formats {
+        {"rgb8", pixel_format::RGB},
+        {"rgba8", pixel_format::RGBA},
+        {"r8", pixel_format::R8},
+        {"rg8", pixel_format::RG8},
+        {"rgb565", pixel_format::RGB565},
+        {"rgba4444", pixel_format::RGBA4444},
+        {"indexed", pixel_format::Indexed8},
+        {"bc1", pixel_format::BC1},
+        {"bc3", pixel_format::BC3},
+        {"bc7", pixel_format::BC7},
+        {"etc2", pixel_format::ETC2_RGB}};
+
+    if (auto it {formats.find(name)}; it != formats.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+////////////////////////////////////////////////////////////
+
+namespace {
+
+struct pixel_stats {
+    bool             Opaque {true};
+    bool             Gray {true};
+    bool             Fits565 {true};
+    bool             Fits4444 {true};
+    std::vector<u32> Colors; // sorted, empty if there are more than 256
+};
+
+auto get_pixel(std::span<u8 const> buf, i32 bpp, isize idx) -> std::array<u8, 4>
+{
+    u8 const* p {buf.data() + (idx * bpp)};
+    return {p[0], p[1], p[2], bpp == 4 ? p[3] : u8 {255}};
+}
+
+auto pack(std::array<u8, 4> const& c) -> u32
+{
+    return (static_cast<u32>(c[0]) << 24) | (static_cast<u32>(c[1]) << 16) | (static_cast<u32>(c[2]) << 8) | c[3];
+}
+
+auto psnr(gfx::image const& img, std::span<u8 const> rgba, i32 channels) -> f64
+{
+    auto const& info {img.info()};
+    auto const  buf {img.data()};
+    i32 const   bpp {info.bytes_per_pixel()};
+    isize const count {static_cast<isize>(info.Size.Width) * info.Size.Height};
+
+    f64 sum {0.0};
+    for (isize i {0}; i < count; ++i) {
+        auto const c {get_pixel(buf, bpp, i)};
+        for (i32 ch {0}; ch < channels; ++ch) {
+            f64 const d {static_cast<f64>(c[ch]) - rgba[(i * 4) + ch]};
+            sum += d * d;
+        }
+    }
+
+    f64 const mse {sum / static_cast<f64>(count * channels)};
+    return mse <= 0.0 ? std::numeric_limits<f64>::infinity() : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+// GPUs widen 4/5/6 bit channels to 8 bits by bit replication, not by rounding q * 255 / max
+auto expand(u32 q, i32 bits) -> u32
+{
+    return (q << (8 - bits)) | (q >> ((2 * bits) - 8));
+}
+
+// level whose expansion is closest to v
+auto quantize(u8 v, i32 bits) -> u32
+{
+    u32 const max {(1u << bits) - 1};
+    u32       retValue {static_cast<u32>(v >> (8 - bits))};
+    auto const dist {[&](u32 q) { return std::abs(static_cast<i32>(expand(q, bits)) - v); }};
+    if (retValue > 0 && dist(retValue - 1) < dist(retValue)) { --retValue; }
+    if (retValue < max && dist(retValue + 1) < dist(retValue)) { ++retValue; }
+    return retValue;
+}
+
+// true if v survives the round trip through a channel with the given bit count
+auto is_exact(u8 v, i32 bits) -> bool
+{
+    return expand(static_cast<u32>(v >> (8 - bits)), bits) == v;
+}
+
+auto analyze(gfx::image const& img) -> pixel_stats
+{
+    auto const& info {img.info()};
+    auto const  buf {img.data()};
+    i32 const   bpp {info.bytes_per_pixel()};
+    isize const count {static_cast<isize>(info.Size.Width) * info.Size.Height};
+
+    pixel_stats           retValue;
+    std::vector<u32>&     colors {retValue.Colors};
+    bool                  countColors {true};
+    for (isize i {0}; i < count; ++i) {
+        auto const c {get_pixel(buf, bpp, i)};
+        retValue.Opaque   = retValue.Opaque && c[3] == 255;
+        retValue.Gray     = retValue.Gray && c[0] == c[1] && c[1] == c[2];
+        retValue.Fits565  = retValue.Fits565 && is_exact(c[0], 5) && is_exact(c[1], 6) && is_exact(c[2], 5);
+        retValue.Fits4444 = retValue.Fits4444 && is_exact(c[0], 4) && is_exact(c[1], 4) && is_exact(c[2], 4) && is_exact(c[3], 4);
+
+        if (countColors) {
+            u32 const packed {pack(c)};
+            auto      it {std::ranges::lower_bound(colors, packed)};
+            if (it == colors.end() || *it != packed) {
+                if (colors.size() == 256) {
+                    countColors = false;
+                    colors.clear();
+                } else {
+                    colors.insert(it, packed);
+                }
+            }
+        }
+    }
+
+    return retValue;
+}
+
+auto luminance(std::array<u8, 4> const& c) -> u8
+{
+    return static_cast<u8>(((c[0] * 299) + (c[1] * 587) + (c[2] * 114) + 500) / 1000);
+}
+
+}
+
+////////////////////////////////////////////////////////////
+
+auto reduce_format(gfx::image const& img, options const& opts) -> std::optional<pixel_data>
+{
+    std::string const& format {opts.Format};
+    auto const&        info {img.info()};
+    pixel_format const srcFormat {info.Format == gfx::image::format::RGBA ? pixel_format::RGBA : pixel_format::RGB};
+
+    pixel_data retValue {.Size = info.Size, .Format = srcFormat, .Source = img.data(), .Buffer = {}, .Palette = {}};
+    if (format == "keep") {
+        return retValue;
+    }
+
+    if (auto const f {parse_format(format)}; f && is_block_format(*f)) {
+        stopwatch  sw {stopwatch::StartNew()};
+        pixel_data compressed {compress_blocks(img, *f, opts.Threads)};
+        f64 const  ms {sw.elapsed_milliseconds()};
+        f64 const  mpix {static_cast<f64>(info.Size.Width) * info.Size.Height / 1e6};
+
+        auto const decoded {decompress_blocks(compressed)};
+        i32 const  channels {*f == pixel_format::BC1 || *f == pixel_format::ETC2_RGB ? 3 : 4};
+        std::cerr << std::format("{} encode: {:.2f}ms ({:.2f} Mpix/s), PSNR: {:.2f}dB\n",
+                                 get_format_name(*f), ms, mpix / (ms / 1000.0), psnr(img, decoded, channels));
+        return compressed;
+    }
+
+    pixel_stats const stats {analyze(img)};
+
+    pixel_format dstFormat {srcFormat};
+    if (format == "auto") {
+        // smallest lossless format, palette included
+        auto const cost {[&](pixel_format f) {
+            pixel_data const p {.Size = info.Size, .Format = f, .Source = {}, .Buffer = {}, .Palette = {}};
+            return p.size_in_bytes() + (f == pixel_format::Indexed8 ? static_cast<i32>(stats.Colors.size() * 4) : 0);
+        }};
+        auto const consider {[&](bool lossless, pixel_format f) {
+            if (lossless && cost(f) < cost(dstFormat)) {
+                dstFormat = f;
+            }
+        }};
+        consider(stats.Opaque, pixel_format::RGB);
+        consider(stats.Fits4444, pixel_format::RGBA4444);
+        consider(stats.Opaque && stats.Fits565, pixel_format::RGB565);
+        consider(stats.Gray, pixel_format::RG8);
+        consider(stats.Gray && stats.Opaque, pixel_format::R8);
+        consider(!stats.Colors.empty(), pixel_format::Indexed8);
+    } else if (auto const f {parse_format(format)}) {
+        dstFormat = *f;
+        if (dstFormat == pixel_format::Indexed8 && stats.Colors.empty()) {
+            std::cerr << "image has more than 256 colors, quantize it first\n";
+            return std::nullopt;
+        }
+    } else {
+        std::cerr << "unknown format: " << format << "\n";
+        return std::nullopt;
+    }
+
+    if (dstFormat == srcFormat) {
+        return retValue;
+    }
+
+    retValue.Format = dstFormat;
+    retValue.Buffer.resize(static_cast<usize>(retValue.size_in_bytes()));
+
+    auto const  buf {img.data()};
+    i32 const   bpp {info.bytes_per_pixel()};
+    isize const count {static_cast<isize>(info.Size.Width) * info.Size.Height};
+    u8*         dst {retValue.Buffer.data()};
+
+    if (dstFormat == pixel_format::Indexed8) {
+        for (u32 const c : stats.Colors) {
+            retValue.Palette.push_back(static_cast<u8>(c >> 24));
+            retValue.Palette.push_back(static_cast<u8>(c >> 16));
+            retValue.Palette.push_back(static_cast<u8>(c >> 8));
+            retValue.Palette.push_back(static_cast<u8>(c));
+        }
+    }
+
+    for (isize i {0}; i < count; ++i) {
+        auto const c {get_pixel(buf, bpp, i)};
+        switch (dstFormat) {
+        case pixel_format::RGB:
+            *dst++ = c[0];
+            *dst++ = c[1];
+            *dst++ = c[2];
+            break;
+        case pixel_format::RGBA:
+            *dst++ = c[0];
+            *dst++ = c[1];
+            *dst++ = c[2];
+            *dst++ = c[3];
+            break;
+        case pixel_format::R8:
+            *dst++ = stats.Gray ? c[0] : luminance(c);
+            break;
+        case pixel_format::RG8:
+            *dst++ = stats.Gray ? c[0] : luminance(c);
+            *dst++ = c[3];
+            break;
+        case pixel_format::RGB565: {
+            u32 const v {(quantize(c[0], 5) << 11) | (quantize(c[1], 6) << 5) | quantize(c[2], 5)};
+            *dst++ = static_cast<u8>(v & 0xFF);
+            *dst++ = static_cast<u8>(v >> 8);
+        } break;
+        case pixel_format::RGBA4444: {
+            u32 const v {(quantize(c[0], 4) << 12) | (quantize(c[1], 4) << 8) | (quantize(c[2], 4) << 4) | quantize(c[3], 4)};
+            *dst++ = static_cast<u8>(v & 0xFF);
+            *dst++ = static_cast<u8>(v >> 8);
+        } break;
+        case pixel_format::Indexed8:
+            *dst++ = static_cast<u8>(std::ranges::lower_bound(stats.Colors, pack(c)) - stats.Colors.begin());
+            break;
+        default: break;
+        }
+    }
+
+    return retValue;
+}
@@ -0,0 +1,196 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static constexpr std::string_view STAMP_PREFIX {"// png2array source:"};
+
+static auto read_file(fs::path const& file) -> std::string
+{
+    std::ifstream in {file, std::ios::binary};
+    return {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}};
+}
+
+static auto hash_file(fs::path const& file) -> u64
+{
+    auto const content {read_file(file)};
+    return hash_bytes({reinterpret_cast<u8 const*>(content.data()), content.size()});
+}
+
+static auto make_stamp(u64 sourceHash, u64 optionsHash) -> std::string
+{
+    return std::format("{} {:016x} options: {:016x}", STAMP_PREFIX, sourceHash, optionsHash);
+}
+
+static auto read_stamp(fs::path const& header) -> std::string
+{
+    std::ifstream in {header};
+    std::string   line;
+    std::getline(in, line);
+    return line.starts_with(STAMP_PREFIX) ? line : "";
+}
+
+// only touches the file if the content differs, to keep its mtime stable
+static auto write_if_changed(fs::path const& file, std::string const& content) -> bool
+{
+    if (fs::exists(file) && fs::file_size(file) == content.size() && read_file(file) == content) {
+        return false;
+    }
+
+    std::ofstream out {file, std::ios::binary | std::ios::trunc};
+    out << content;
+    return true;
+}
+
+// streams the temporary file over the target, unless both are identical
+static auto replace_if_changed(fs::path const& tmp, fs::path const& file) -> bool
+{
+    bool same {fs::exists(file) && fs::file_size(file) == fs::file_size(tmp)};
+    if (same) {
+        std::ifstream     a {tmp, std::ios::binary};
+        std::ifstream     b {file, std::ios::binary};
+        std::vector<char> bufA(64 * 1024);
+        std::vector<char> bufB(64 * 1024);
+        while (same && a && b) {
+            a.read(bufA.data(), static_cast<std::streamsize>(bufA.size()));
+            b.read(bufB.data(), static_cast<std::streamsize>(bufB.size()));
+            same = a.gcount() == b.gcount() && std::equal(bufA.begin(), bufA.begin() + a.gcount(), bufB.begin());
+        }
+    }
+
+    std::error_code ec;
+    if (same) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+
+    fs::rename(tmp, file, ec);
+    return !ec;
+}
+
+static auto is_newer(fs::path const& a, fs::path const& b) -> bool
+{
+    std::error_code ec;
+    auto const      ta {fs::last_write_time(a, ec)};
+    if (ec) { return false; }
+    auto const tb {fs::last_write_time(b, ec)};
+    if (ec) { return false; }
+    return ta >= tb;
+}
+
+auto write_folder(std::vector<std::string> const& files, std::string const& outFolder, options const& opts) -> int
+{
+    u64 const optionsHash {hash_options(opts)};
+
+    fs::path const outDir {outFolder};
+    std::error_code ec;
+    fs::create_directories(outDir, ec);
+    if (!fs::is_directory(outDir)) {
+        std::cout << "error creating output folder: " << outFolder << "\n";
+        return 1;
+    }
+
+    i32         skipped {0};
+    i32         written {0};
+    std::string index {"#pragma once\n\n"};
+
+    for (auto const& file : files) {
+        auto const     stem {io::get_stem(file)};
+        fs::path const header {outDir / (stem + ".hpp")};
+        index += std::format("#include \"{}.hpp\"\n", stem);
+
+        // cheap check first: header is newer than the source and was built with the same options
+        auto const oldStamp {read_stamp(header)};
+        if (!oldStamp.empty() && oldStamp.ends_with(std::format("{:016x}", optionsHash)) && is_newer(header, file)) {
+            ++skipped;
+            continue;
+        }
+
+        // timestamps disagree, compare content hashes
+        auto const stamp {make_stamp(hash_file(file), optionsHash)};
+        if (stamp == oldStamp) {
+            ++skipped;
+            continue;
+        }
+
+        fs::path const tmp {header.string() + ".tmp"};
+        {
+            std::ofstream out {tmp, std::ios::binary | std::ios::trunc};
+            out << stamp << "\n#pragma once\n\n" << preamble();
+            if (!convert(file, opts, out)) {
+                out.close();
+                fs::remove(tmp, ec);
+                return 1;
+            }
+        }
+
+        if (replace_if_changed(tmp, header)) {
+            std::cout << "generated: " << header.string() << "\n";
+            ++written;
+        } else {
+            ++skipped;
+        }
+    }
+
+    if (write_if_changed(outDir / "png2array.hpp", index)) {
+        std::cout << "generated: " << (outDir / "png2array.hpp").string() << "\n";
+    }
+
+    std::cout << std::format("{} header(s) written, {} up to date\n", written, skipped);
+    return 0;
+}
+
+auto write_atlas_folder(std::vector<std::string> const& files, std::string const& outFolder, options const& opts) -> int
+{
+    u64 const          optionsHash {hash_options(opts)};
+    std::string const& name {opts.AtlasName};
+
+    fs::path const outDir {outFolder};
+    std::error_code ec;
+    fs::create_directories(outDir, ec);
+    if (!fs::is_directory(outDir)) {
+        std::cout << "error creating output folder: " << outFolder << "\n";
+        return 1;
+    }
+
+    // the atlas depends on every image, so the source key combines all of them
+    std::string sourceKey;
+    for (auto const& file : files) {
+        sourceKey += std::format("{}:{:016x};", io::get_stem(file), hash_file(file));
+    }
+
+    fs::path const header {outDir / (name + ".hpp")};
+    auto const     stamp {make_stamp(hash_bytes({reinterpret_cast<u8 const*>(sourceKey.data()), sourceKey.size()}), optionsHash)};
+    if (stamp == read_stamp(header)) {
+        std::cout << "up to date: " << header.string() << "\n";
+        return 0;
+    }
+
+    auto const atlas {pack_atlas(files, opts.AtlasGap)};
+    if (!atlas) {
+        return 1;
+    }
+
+    fs::path const tmp {header.string() + ".tmp"};
+    {
+        std::ofstream out {tmp, std::ios::binary | std::ios::trunc};
+        out << stamp << "\n#pragma once\n\n" << preamble();
+        if (!convert_atlas(*atlas, opts, out)) {
+            out.close();
+            fs::remove(tmp, ec);
+            return 1;
+        }
+    }
+
+    if (replace_if_changed(tmp, header)) {
+        std::cout << "generated: " << header.string() << "\n";
+    }
+    return 0;
+}
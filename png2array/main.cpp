@@ -4,48 +4,36 @@
 // https://opensource.org/licenses/MIT
 
 #include "../shared/argparse.hpp"
-#include <iostream>
-#include <sstream>
-#include <tcob/tcob.hpp>
-
-using namespace tcob;
-namespace io = tcob::io;
-
-static auto convert(std::string const& srcFile) -> std::string
-{
-    if (auto const img {gfx::image::Load(srcFile)}) {
-        std::stringstream ss;
-        auto const        size {img->info().size_in_bytes()};
-        auto const        buf {img->data()};
-
-        ss << "constexpr std::array<uint8_t, " << size << "> " << io::get_stem(srcFile);
-        ss << " {";
-
-        for (i32 i {0}; i < size; ++i) {
-            if (i % 16 == 0) {
-                ss << "\n ";
-            }
-            ss << "0x"
-               << std::setfill('0') << std::setw(2)
-               << std::hex << static_cast<u32>(buf[i]);
-
-            if (i != size - 1) {
-                ss << ", ";
-            }
-        }
-
-        ss << " };\n";
-
-        return ss.str();
-    }
-
-    return "";
-}
+#include "common.hpp"
 
 auto main(int argc, char* argv[]) -> int
 {
     argparse::ArgumentParser program("png2array");
     program.add_argument("folder");
+    program.add_argument("--atlas")
+        .help("pack all images into a single texture atlas")
+        .flag();
+    program.add_argument("--atlas-name")
+        .help("name of the generated atlas array")
+        .default_value("atlas");
+    program.add_argument("--atlas-gap")
+        .help("gap between atlas regions in pixels")
+        .default_value(2)
+        .scan<'i', i32>();
+    program.add_argument("-f", "--format")
+        .help("pixel format of the generated arrays; 'auto' picks the smallest lossless one")
+        .default_value("keep")
+        .choices("keep", "auto", "rgba8", "rgb8", "rg8", "r8", "rgb565", "rgba4444", "indexed", "bc1", "bc3", "bc7", "etc2");
+    program.add_argument("-j", "--threads")
+        .help("number of threads used for block compression, 0 uses all cores")
+        .default_value(0)
+        .scan<'i', i32>();
+    program.add_argument("--mips")
+        .help("append the full mipmap chain, downsampled with a gamma correct box filter")
+        .flag();
+    program.add_argument("-o", "--output")
+        .help("write one header per image plus an index into this folder, regenerating only changed images")
+        .default_value("");
 
     try {
         program.parse_args(argc, argv);
@@ -55,6 +43,8 @@ auto main(int argc, char* argv[]) -> int
         return 1;
     }
 
+    std::ios::sync_with_stdio(false);
+
     auto pl {platform::HeadlessInit()};
 
     std::string const arg {program.get("folder")};
@@ -64,11 +54,34 @@ auto main(int argc, char* argv[]) -> int
 
     auto const files {io::enumerate(arg, {.String = "*.png"})};
 
-    std::cout << "#include <array>\n";
-    std::cout << "#include <cstdint>\n\n";
+    options const opts {
+        .Format    = program.get("--format"),
+        .Threads   = program.get<i32>("--threads"),
+        .Mips      = program.get<bool>("--mips"),
+        .Atlas     = program.get<bool>("--atlas"),
+        .AtlasName = program.get("--atlas-name"),
+        .AtlasGap  = std::max(0, program.get<i32>("--atlas-gap"))};
+
+    std::string const output {program.get("--output")};
+    if (!output.empty()) {
+        return opts.Atlas ? write_atlas_folder(files, output, opts)
+                          : write_folder(files, output, opts);
+    }
+
+    if (opts.Atlas) {
+        auto const atlas {pack_atlas(files, opts.AtlasGap)};
+        if (!atlas) {
+            return 1;
+        }
+
+        std::cout << preamble();
+        return convert_atlas(*atlas, opts, std::cout) ? 0 : 1;
+    }
+
+    std::cout << preamble();
 
     for (auto const& file : files) {
-        std::cout << convert(file);
+        std::ignore = convert(file, opts, std::cout);
     }
 
     return 0;
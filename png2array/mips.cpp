@@ -0,0 +1,80 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+namespace {
+
+auto srgb_to_linear_table() -> std::array<f32, 256>
+{
+    std::array<f32, 256> retValue {};
+    for (usize i {0}; i < 256; ++i) {
+        f32 const v {static_cast<f32>(i) / 255.0f};
+        retValue[i] = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+    }
+    return retValue;
+}
+
+auto linear_to_srgb(f32 v) -> u8
+{
+    v = std::clamp(v, 0.0f, 1.0f);
+    f32 const s {v <= 0.0031308f ? v * 12.92f : (1.055f * std::pow(v, 1.0f / 2.4f)) - 0.055f};
+    return static_cast<u8>(std::lround(s * 255.0f));
+}
+
+// 2x2 box filter in linear light, color weighted by alpha; for odd sizes the last row and
+// column widen the footprint of the texels next to them, so no source texel is dropped
+auto downsample(gfx::image const& src, std::array<f32, 256> const& toLinear) -> gfx::image
+{
+    auto const&  info {src.info()};
+    size_i const size {std::max(1, info.Size.Width / 2), std::max(1, info.Size.Height / 2)};
+    i32 const    bpp {info.bytes_per_pixel()};
+    bool const   hasAlpha {bpp == 4};
+
+    auto       retValue {gfx::image::CreateEmpty(size, info.Format)};
+    auto const srcBuf {src.data()};
+    auto       dstBuf {retValue.data()};
+
+    for (i32 y {0}; y < size.Height; ++y) {
+        for (i32 x {0}; x < size.Width; ++x) {
+            i32 const x0 {std::min(x * 2, info.Size.Width - 1)};
+            i32 const y0 {std::min(y * 2, info.Size.Height - 1)};
+            i32 const x1 {x == size.Width - 1 ? info.Size.Width : x0 + 2};
+            i32 const y1 {y == size.Height - 1 ? info.Size.Height : y0 + 2};
+
+            std::array<f32, 3> color {};
+            f32                alpha {0.0f};
+            for (i32 sy {y0}; sy < y1; ++sy) {
+                for (i32 sx {x0}; sx < x1; ++sx) {
+                    u8 const* p {srcBuf.data() + ((static_cast<isize>(sy) * info.Size.Width) + sx) * bpp};
+                    f32 const a {hasAlpha ? static_cast<f32>(p[3]) / 255.0f : 1.0f};
+                    for (i32 c {0}; c < 3; ++c) { color[c] += toLinear[p[c]] * a; }
+                    alpha += a;
+                }
+            }
+            f32 const texels {static_cast<f32>((x1 - x0) * (y1 - y0))};
+
+            u8* q {dstBuf.data() + ((static_cast<isize>(y) * size.Width) + x) * bpp};
+            for (i32 c {0}; c < 3; ++c) { q[c] = alpha > 0.0f ? linear_to_srgb(color[c] / alpha) : 0; }
+            if (hasAlpha) { q[3] = static_cast<u8>(std::lround(alpha / texels * 255.0f)); }
+        }
+    }
+
+    return retValue;
+}
+
+}
+
+auto build_mip_chain(gfx::image const& img) -> std::vector<gfx::image>
+{
+    static std::array<f32, 256> const toLinear {srgb_to_linear_table()};
+
+    std::vector<gfx::image> retValue;
+    retValue.push_back(img);
+    while (retValue.back().info().Size.Width > 1 || retValue.back().info().Size.Height > 1) {
+        retValue.push_back(downsample(retValue.back(), toLinear));
+    }
+    return retValue;
+}
@@ -0,0 +1,320 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "../shared/parallel.hpp"
+#include "common.hpp"
+
+#include <atomic>
+
+namespace {
+
+// colors that are still in the new palette keep their index from the previous one,
+// so unchanged pixels can keep their indices across a palette switch
+auto align_palette(std::span<color const> previous, std::vector<color> const& next) -> std::vector<color>
+{
+    usize const        count {next.size()};
+    usize const        shared {std::min(count, previous.size())};
+    std::vector<color> retValue(count);
+    std::vector<bool>  taken(count, false);
+    std::vector<bool>  placed(count, false);
+    for (usize i {0}; i < count; ++i) {
+        for (usize j {0}; j < shared; ++j) {
+            if (!taken[j] && previous[j] == next[i]) {
+                retValue[j] = next[i];
+                taken[j]    = true;
+                placed[i]   = true;
+                break;
+            }
+        }
+    }
+
+    usize slot {0};
+    for (usize i {0}; i < count; ++i) {
+        if (placed[i]) { continue; }
+        while (taken[slot]) { ++slot; }
+        retValue[slot] = next[i];
+        taken[slot]    = true;
+    }
+    return retValue;
+}
+
+auto same_rgb(u8 const* a, u8 const* b) -> bool
+{
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+auto same_rgb(color const& a, color const& b) -> bool
+{
+    return a.R == b.R && a.G == b.G && a.B == b.B;
+}
+
+}
+
+////////////////////////////////////////////////////////////
+
+auto quantize_animation(options const& opts, string const& quantizer, string const& inFolder, string const& output) -> i32
+{
+    auto const sw {stopwatch::StartNew()};
+
+    string extension {io::get_extension(output)};
+    std::ranges::transform(extension, extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    if (extension != ".gif") { return print_error("animation mode writes gif files: " + output); }
+
+    // enumeration order depends on the file system, frames go in name order
+    auto files {io::enumerate(inFolder, {.String = "*.png"})};
+    if (files.empty()) { return print_error("no frames found: " + inFolder); }
+    std::ranges::sort(files);
+
+    // frames are loaded and counted in parallel, one frame per job
+    std::vector<gfx::image>      frames(files.size());
+    std::vector<color_histogram> histograms(files.size());
+    std::atomic<bool>            failed {false};
+    std::atomic<bool>            transparent {false};
+    parallel_for(std::ssize(files), opts.Threads, [&](isize begin, isize end) {
+        for (isize i {begin}; i < end; ++i) {
+            auto img {gfx::image::Load(files[i])};
+            if (!img) {
+                failed = true;
+                continue;
+            }
+            // transparent pixels get their own index, their hidden colors don't train the palettes
+            bool const hasTransparency {has_transparency(*img)};
+            if (hasTransparency) { transparent = true; }
+            if (opts.PaletteFile.empty()) {
+                histograms[i] = color_histogram::Build(*img, 1);
+                if (hasTransparency) { histograms[i].remove_transparent(); }
+            }
+            frames[i] = std::move(*img);
+        }
+    });
+    if (failed) { return print_error("error loading frames: " + inFolder); }
+
+    auto const  size {frames[0].info().Size};
+    isize const frameCount {std::ssize(frames)};
+    if (std::ranges::any_of(frames, [&](gfx::image const& img) { return img.info().Size != size; })) {
+        return print_error("all frames need the size of the first one");
+    }
+    std::cout << std::format("{} frames of {}x{} loaded in {}ms\n", frameCount, size.Width, size.Height, sw.elapsed_milliseconds());
+
+    // palette windows: each trains on its own frames and those of the window before it,
+    // so consecutive palettes share half of their input and change gradually
+    isize const window {opts.PaletteWindow > 0 ? std::min<isize>(opts.PaletteWindow, frameCount) : frameCount};
+    isize const windowCount {(frameCount + window - 1) / window};
+    auto const  paletteSw {stopwatch::StartNew()};
+
+    std::vector<std::vector<color>> palettes(static_cast<usize>(windowCount));
+    std::vector<std::vector<f64>>   refineMse(static_cast<usize>(windowCount));
+    if (!opts.PaletteFile.empty()) {
+        auto loaded {read_palette(opts.PaletteFile)};
+        if (!loaded) { return print_error("error loading palette: " + opts.PaletteFile); }
+        std::ranges::fill(palettes, *loaded);
+    } else {
+        // one entry stays free for transparent pixels
+        options trainOpts {opts};
+        if (transparent) { trainOpts.Colors = std::min(opts.Colors, 255); }
+        parallel_for(windowCount, opts.Threads, [&](isize begin, isize end) {
+            for (isize w {begin}; w < end; ++w) {
+                auto const first {histograms.begin() + (std::max<isize>(0, w - 1) * window)};
+                auto const last {histograms.begin() + std::min(frameCount, (w + 1) * window)};
+                auto const hist {color_histogram::Merge({first, last})};
+                palettes[w] = train_palette(quantizer, hist, trainOpts);
+                if (opts.Refine > 0) {
+                    auto refined {refine_palette(palettes[w], hist, opts.ColorSpace, opts.Refine, 1)};
+                    palettes[w]  = std::move(refined.Palette);
+                    refineMse[w] = std::move(refined.Mse);
+                }
+            }
+        });
+        histograms.clear();
+        for (usize w {1}; w < palettes.size(); ++w) { palettes[w] = align_palette(palettes[w - 1], palettes[w]); }
+    }
+    std::cout << std::format("{} palette(s) in {}ms\n", windowCount, paletteSw.elapsed_milliseconds());
+    for (usize w {0}; w < refineMse.size(); ++w) {
+        if (refineMse[w].empty()) { continue; }
+        std::cout << std::format("palette {}: refined in {} iterations, {} MSE {:.2f} -> {:.2f}\n", w, refineMse[w].size() - 1, get_color_space_name(opts.ColorSpace), refineMse[w].front(), refineMse[w].back());
+    }
+    if (!opts.SavePalette.empty() && !write_palette(opts.SavePalette, palettes[0])) { return print_error("error saving palette: " + opts.SavePalette); }
+
+    usize colors {0};
+    for (auto const& pal : palettes) { colors = std::max(colors, pal.size()); }
+    if (colors > 256) { return print_error("animations support at most 256 colors"); }
+    if (transparent && colors == 256) { return print_error("animations with transparent pixels support at most 255 colors"); }
+
+    // the entry after the largest palette marks transparent pixels, and in delta frames also
+    // the unchanged ones, if the palettes leave room for it
+    bool const keepSlot {colors < 256};
+    u8 const   keep {static_cast<u8>(colors)};
+
+    std::vector<palette_matcher> matchers;
+    matchers.reserve(palettes.size());
+    for (auto const& pal : palettes) {
+        matchers.emplace_back(pal, opts.ColorSpace);
+        if (opts.ColormapBits > 0) { matchers.back().build_colormap(opts.ColormapBits, opts.ColormapExact, opts.Threads); }
+    }
+    auto const windowOf {[&](isize frame) { return static_cast<usize>(frame / window); }};
+
+    // every frame is dithered on its own, one frame per job
+    auto const                   ditherSw {stopwatch::StartNew()};
+    std::vector<std::vector<u8>> indices(frames.size());
+    parallel_for(frameCount, opts.Threads, [&](isize begin, isize end) {
+        for (isize i {begin}; i < end; ++i) {
+            indices[i] = dither_indices(frames[i], matchers[windowOf(i)], opts.Dithering, 1);
+            if (transparent) { mark_transparent(frames[i], indices[i], keep); }
+        }
+    });
+
+    // Error diffusion spreads changes across the frame. Pixels with an unchanged source keep
+    // their previous index while it still has the same color, which makes every kind of
+    // dithering temporally stable. Each frame depends on the one before it, rows run in parallel.
+    usize const        pixels {static_cast<usize>(size.Width) * static_cast<usize>(size.Height)};
+    std::atomic<isize> stabilized {0};
+    for (isize i {1}; i < frameCount; ++i) {
+        auto const& prevPal {palettes[windowOf(i - 1)]};
+        auto const& pal {palettes[windowOf(i)]};
+        auto const  prevSrc {frames[i - 1].data()};
+        auto const  src {frames[i].data()};
+        i32 const   prevBpp {frames[i - 1].info().bytes_per_pixel()};
+        i32 const   bpp {frames[i].info().bytes_per_pixel()};
+        auto const& prev {indices[i - 1]};
+        auto&       cur {indices[i]};
+
+        parallel_for(size.Height, opts.Threads, [&](isize begin, isize end) {
+            isize kept {0};
+            for (usize p {static_cast<usize>(begin) * size.Width}; p < static_cast<usize>(end) * size.Width; ++p) {
+                u8 const idx {prev[p]};
+                if (cur[p] == idx || idx >= pal.size() || cur[p] >= pal.size() || !same_rgb(pal[idx], prevPal[idx])) { continue; }
+                if (!same_rgb(src.data() + (p * bpp), prevSrc.data() + (p * prevBpp))) { continue; }
+                cur[p] = idx;
+                ++kept;
+            }
+            stabilized += kept;
+        });
+    }
+
+    // A pixel that turns transparent can't be drawn over the previous frame. The frame before
+    // it clears the canvas once shown, and the frame itself is stored whole.
+    std::vector<u8> clears(frames.size(), 0);
+    if (transparent) {
+        parallel_for(frameCount - 1, opts.Threads, [&](isize begin, isize end) {
+            for (isize i {begin + 1}; i < end + 1; ++i) {
+                auto const& cur {indices[i]};
+                auto const& prev {indices[i - 1]};
+                for (usize p {0}; p < pixels && !clears[i]; ++p) { clears[i] = cur[p] == keep && prev[p] != keep; }
+            }
+        });
+    }
+
+    // delta frames: the bounding box of the pixels whose color changed; inside it, unchanged
+    // pixels use the transparent index if the palettes leave room for it
+    std::vector<animation_frame> out(frames.size());
+    std::vector<isize>           changedPixels(frames.size(), 0);
+    i32 const                    delay {(std::max(0, opts.FrameDelay) + 5) / 10};
+
+    auto const framePalette {[&](usize w) {
+        std::vector<color> retValue {palettes[w]};
+        if (keepSlot) {
+            retValue.resize(colors, color {0, 0, 0, 255});
+            retValue.push_back(color {0, 0, 0, 0});
+        }
+        return retValue;
+    }};
+
+    parallel_for(frameCount, opts.Threads, [&](isize begin, isize end) {
+        for (isize i {begin}; i < end; ++i) {
+            auto& frame {out[i]};
+            frame.Delay   = delay;
+            frame.Dispose = i + 1 < frameCount && clears[i + 1];
+            if (windowOf(i) > 0) { frame.Palette = framePalette(windowOf(i)); }
+            if (keepSlot && (i > 0 || transparent)) { frame.Transparent = keep; }
+            auto const& cur {indices[i]};
+            if (i == 0) {
+                frame.Bounds     = {0, 0, size.Width, size.Height};
+                frame.Indices    = cur;
+                changedPixels[i] = static_cast<isize>(pixels);
+                continue;
+            }
+
+            auto const& prevPal {palettes[windowOf(i - 1)]};
+            auto const& pal {palettes[windowOf(i)]};
+            auto const& prev {indices[i - 1]};
+            auto const  changed {[&](usize p) {
+                if (cur[p] == keep || prev[p] == keep) { return cur[p] != prev[p]; }
+                return !same_rgb(pal[cur[p]], prevPal[prev[p]]);
+            }};
+
+            i32   left {size.Width};
+            i32   top {size.Height};
+            i32   right {-1};
+            i32   bottom {-1};
+            isize count {0};
+            for (i32 y {0}; y < size.Height; ++y) {
+                for (i32 x {0}; x < size.Width; ++x) {
+                    if (!changed((static_cast<usize>(y) * size.Width) + x)) { continue; }
+                    left   = std::min(left, x);
+                    right  = std::max(right, x);
+                    top    = std::min(top, y);
+                    bottom = std::max(bottom, y);
+                    ++count;
+                }
+            }
+            changedPixels[i] = count;
+
+            // drawn on a cleared canvas, stored whole
+            if (clears[i]) {
+                frame.Bounds  = {0, 0, size.Width, size.Height};
+                frame.Indices = cur;
+                continue;
+            }
+
+            // the canvas is cleared after this frame, so it covers all of it
+            if (frame.Dispose) {
+                left   = 0;
+                top    = 0;
+                right  = size.Width - 1;
+                bottom = size.Height - 1;
+            } else if (count == 0) {
+                // nothing changed: a single pixel keeps the frame and its delay
+                frame.Bounds  = {0, 0, 1, 1};
+                frame.Indices = {keepSlot ? keep : cur[0]};
+                continue;
+            }
+
+            frame.Bounds = {left, top, right - left + 1, bottom - top + 1};
+            frame.Indices.reserve(static_cast<usize>(frame.Bounds.Width) * static_cast<usize>(frame.Bounds.Height));
+            for (i32 y {top}; y <= bottom; ++y) {
+                for (i32 x {left}; x <= right; ++x) {
+                    usize const p {(static_cast<usize>(y) * size.Width) + x};
+                    frame.Indices.push_back(keepSlot && !changed(p) ? keep : cur[p]);
+                }
+            }
+        }
+    });
+    auto const ditherMs {ditherSw.elapsed_milliseconds()};
+
+    f64 squaredError {0.0};
+    for (isize i {0}; i < frameCount; ++i) {
+        squaredError += mean_squared_error(frames[i], indexed_image {.Size = size, .Indices = indices[i], .Palette = framePalette(windowOf(i))});
+    }
+    f64 const mse {squaredError / static_cast<f64>(frameCount)};
+
+    isize storedPixels {0};
+    isize totalChanged {0};
+    for (isize i {1}; i < frameCount; ++i) {
+        storedPixels += static_cast<isize>(out[i].Indices.size());
+        totalChanged += changedPixels[i];
+    }
+    f64 const deltaPixels {static_cast<f64>(pixels) * static_cast<f64>(frameCount - 1)};
+
+    if (!save_animation(output, size, framePalette(0), out)) { return print_error("error saving animation: " + output); }
+
+    f64 const mpix {static_cast<f64>(pixels) * static_cast<f64>(frameCount) / 1.0e6};
+    std::cout << std::format("dithering and deltas: {}ms, {:.1f} Mpix/s, {} pixels kept stable\n", ditherMs, ditherMs > 0 ? mpix / ditherMs * 1000.0 : 0.0, stabilized.load());
+    if (frameCount > 1) {
+        std::cout << std::format("changed pixels: {:.1f}%, stored in dirty rects: {:.1f}%\n", 100.0 * static_cast<f64>(totalChanged) / deltaPixels, 100.0 * static_cast<f64>(storedPixels) / deltaPixels);
+    }
+    std::cout << std::format("MSE: {:.2f}, PSNR: {:.2f}dB\n", mse, psnr(mse));
+    std::cout << std::format("done in {}ms!\n", sw.elapsed_milliseconds());
+    return 0;
+}
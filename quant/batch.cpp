@@ -0,0 +1,103 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "../shared/parallel.hpp"
+#include "common.hpp"
+
+#include <filesystem>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+auto train_palette(string const& quantizer, color_histogram const& hist, options const& opts) -> std::vector<color>
+{
+    if (quantizer == "wu") { return wu_quant::GetPalette(hist, opts.Colors); }
+
+    // neuquant and octree need pixels, feed them the merged histogram
+    auto const training {make_training_image(hist, opts.SampleRate, opts.MaxSamples > 0 ? opts.MaxSamples : i64 {1} << 22)};
+    if (quantizer == "neuquant") { return gfx::neuquant::GetPalette(training, opts.Colors); }
+    return gfx::octree_quant::GetPalette(training, opts.Colors);
+}
+
+auto quantize_batch(options const& opts, string const& quantizer, string const& inFolder, string const& outFolder) -> i32
+{
+    auto const sw {stopwatch::StartNew()};
+
+    auto const files {io::enumerate(inFolder, {.String = "*.png"})};
+    if (files.empty()) { return print_error("no images found: " + inFolder); }
+
+    std::error_code ec;
+    fs::create_directories(outFolder, ec);
+    if (!fs::is_directory(outFolder)) { return print_error("error creating output folder: " + outFolder); }
+
+    // one job per image; each image is processed single-threaded
+    std::vector<gfx::image>      images(files.size());
+    std::vector<color_histogram> histograms(files.size());
+    std::atomic<bool>            failed {false};
+    std::atomic<bool>            transparent {false};
+    parallel_for(std::ssize(files), opts.Threads, [&](isize begin, isize end) {
+        for (isize i {begin}; i < end; ++i) {
+            auto img {gfx::image::Load(files[i])};
+            if (!img) {
+                failed = true;
+                continue;
+            }
+            if (opts.PaletteFile.empty()) { histograms[i] = color_histogram::Build(*img, 1); }
+            if (opts.Indexed && has_transparency(*img)) { transparent = true; }
+            images[i] = std::move(*img);
+        }
+    });
+    if (failed) { return print_error("error loading images: " + inFolder); }
+
+    std::vector<color> pal;
+    if (!opts.PaletteFile.empty()) {
+        auto loaded {read_palette(opts.PaletteFile)};
+        if (!loaded) { return print_error("error loading palette: " + opts.PaletteFile); }
+        pal = std::move(*loaded);
+        std::cout << std::format("{} images loaded in {}ms\n", files.size(), sw.elapsed_milliseconds());
+    } else {
+        auto const hist {color_histogram::Merge(histograms)};
+        histograms.clear();
+        std::cout << std::format("{} images, {} colors in {}ms\n", files.size(), hist.color_count(), sw.elapsed_milliseconds());
+
+        auto const paletteSw {stopwatch::StartNew()};
+        // indexed output keeps one entry free for transparent pixels
+        options trainOpts {opts};
+        if (transparent) { trainOpts.Colors = std::min(opts.Colors, 255); }
+        pal = train_palette(quantizer, hist, trainOpts);
+        std::cout << std::format("shared palette: {} colors in {}ms\n", pal.size(), paletteSw.elapsed_milliseconds());
+        pal = refine_palette(pal, hist, opts);
+    }
+    if (!opts.SavePalette.empty() && !write_palette(opts.SavePalette, pal)) { return print_error("error saving palette: " + opts.SavePalette); }
+
+    palette_matcher matcher {pal, opts.ColorSpace};
+    if (opts.ColormapBits > 0) { matcher.build_colormap(opts.ColormapBits, opts.ColormapExact, opts.Threads); }
+
+    std::mutex coutMutex;
+    parallel_for(std::ssize(files), opts.Threads, [&](isize begin, isize end) {
+        for (isize i {begin}; i < end; ++i) {
+            string const output {(fs::path {outFolder} / (io::get_stem(files[i]) + ".png")).string()};
+            bool         saved {false};
+            if (opts.Indexed) {
+                auto const indexed {make_indexed(images[i], matcher, opts.Dithering, 1)};
+                saved = indexed && save_indexed(*indexed, output);
+            } else {
+                saved = dither_image(images[i], matcher, opts.Dithering, 1).save(output);
+            }
+            if (!saved) {
+                std::scoped_lock lock {coutMutex};
+                std::cout << "error saving image: " << output << "\n";
+                failed = true;
+            }
+        }
+    });
+    if (failed) { return 1; }
+
+    string const paletteFile {(fs::path {outFolder} / "palette.gpl").string()};
+    if (!write_palette(paletteFile, pal)) { return print_error("error writing palette: " + paletteFile); }
+
+    std::cout << std::format("done in {}ms!\n", sw.elapsed_milliseconds());
+    return 0;
+}
@@ -0,0 +1,664 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+// Without arguments: kernel benchmarks that also check the fast paths against their references.
+// With --matrix: quantizer x dithering x color space x colors x image timings with quality metrics, as CSV/JSON.
+
+#include "../shared/argparse.hpp"
+
+#include "common.hpp"
+
+#include <random>
+#include <unordered_set>
+
+// synthetic 4k test image: smooth gradients plus noise, so all palette regions are hit
+auto make_image(size_i size, std::mt19937& rng) -> gfx::image
+{
+    auto                                img {gfx::image::CreateEmpty(size, gfx::image::format::RGB)};
+    auto                                data {img.data()};
+    std::uniform_int_distribution<i32> noise {-24, 24};
+
+    usize i {0};
+    for (i32 y {0}; y < size.Height; ++y) {
+        for (i32 x {0}; x < size.Width; ++x) {
+            data[i++] = static_cast<u8>(std::clamp((x * 255 / size.Width) + noise(rng), 0, 255));
+            data[i++] = static_cast<u8>(std::clamp((y * 255 / size.Height) + noise(rng), 0, 255));
+            data[i++] = static_cast<u8>(std::clamp(((x + y) * 255 / (size.Width + size.Height)) + noise(rng), 0, 255));
+        }
+    }
+    return img;
+}
+
+auto make_palette(i32 count, std::mt19937& rng) -> std::vector<color>
+{
+    std::uniform_int_distribution<i32> channel {0, 255};
+    std::vector<color>                 retValue;
+    retValue.reserve(static_cast<usize>(count));
+    for (i32 i {0}; i < count; ++i) {
+        retValue.push_back(color {static_cast<u8>(channel(rng)), static_cast<u8>(channel(rng)), static_cast<u8>(channel(rng)), 255});
+    }
+    return retValue;
+}
+
+template <typename Func>
+auto run(gfx::image const& img, std::vector<i32>& out, Func&& func) -> f64
+{
+    auto const data {img.data()};
+    auto       sw {stopwatch::StartNew()};
+    for (usize i {0}, p {0}; p < out.size(); i += 3, ++p) {
+        out[p] = func(data[i], data[i + 1], data[i + 2]);
+    }
+    return sw.elapsed_milliseconds();
+}
+
+// the compile-time sized search with_search() picks for palettes of up to N colors
+template <i32 N>
+auto run_fixed(gfx::image const& img, std::vector<i32>& out, palette_matcher const& matcher) -> f64
+{
+    fixed_palette_matcher<N> const fixed {matcher};
+    return run(img, out, [&](i32 r, i32 g, i32 b) { return fixed.nearest(r, g, b); });
+}
+
+// inverse colormap: build time, ambiguous cells, lookup speed and how many pixels differ from the full search
+auto bench_colormap(gfx::image const& img, std::vector<i32> const& reference, palette_matcher matcher, i32 colors, f64 mpix) -> i32
+{
+    i32              failed {0};
+    std::vector<i32> mapped(reference.size());
+    for (i32 const bits : {5, 6}) {
+        for (bool const exact : {false, true}) {
+            auto        sw {stopwatch::StartNew()};
+            isize const ambiguous {matcher.build_colormap(bits, exact, 0)};
+            f64 const   buildMs {sw.elapsed_milliseconds()};
+            f64 const   lookupMs {run(img, mapped, [&](i32 r, i32 g, i32 b) { return matcher.nearest(r, g, b); })};
+
+            isize differ {0};
+            for (usize i {0}; i < mapped.size(); ++i) {
+                if (mapped[i] != reference[i]) { ++differ; }
+            }
+
+            std::cout << std::format("{:>8} {:>6} {:>7} {:>10.1f} {:>11.2f}% {:>10.1f} {:>11.3f}%\n",
+                                     colors, 1 << bits, exact ? "exact" : "approx", buildMs,
+                                     100.0 * static_cast<f64>(ambiguous) / static_cast<f64>(1 << (3 * bits)),
+                                     mpix / lookupMs * 1000.0, 100.0 * static_cast<f64>(differ) / static_cast<f64>(mapped.size()));
+            if (exact && differ > 0) { ++failed; }
+        }
+    }
+    return failed;
+}
+
+// one dither filter on one thread vs several, the output must not change
+template <typename Make>
+auto bench_threads(string const& name, gfx::image const& img, Make&& make) -> i32
+{
+    i32        failed {0};
+    auto const size {img.info().Size};
+    f64 const  mpix {static_cast<f64>(size.Width) * size.Height / 1.0e6};
+    f64        serialMs {0};
+    gfx::image serial;
+    for (i32 const threads : {1, 2, 4, 0}) {
+        auto       sw {stopwatch::StartNew()};
+        auto const out {make(threads)(img)};
+        f64 const  ms {sw.elapsed_milliseconds()};
+        if (threads == 1) {
+            serialMs = ms;
+            serial   = out;
+        } else if (!std::ranges::equal(out.data(), serial.data())) {
+            std::cout << std::format("  {} output differs with {} threads\n", name, threads);
+            ++failed;
+        }
+        std::cout << std::format("{:>16} {:>8} {:>12.1f} {:>12.1f} {:>7.2f}x\n", name, threads == 0 ? "all" : std::to_string(threads), ms, mpix / ms * 1000.0, serialMs / ms);
+    }
+    return failed;
+}
+
+// histogram build vs a hash set over all pixels, as count_colors() does
+auto bench_histogram(gfx::image const& img) -> i32
+{
+    i32        failed {0};
+    auto const size {img.info().Size};
+    f64 const  mpix {static_cast<f64>(size.Width) * size.Height / 1.0e6};
+    auto const data {img.data()};
+
+    auto                    sw {stopwatch::StartNew()};
+    std::unordered_set<u32> set;
+    for (usize i {0}; i < data.size(); i += 3) {
+        set.insert((static_cast<u32>(data[i]) << 16) | (static_cast<u32>(data[i + 1]) << 8) | data[i + 2]);
+    }
+    f64 const setMs {sw.elapsed_milliseconds()};
+    std::cout << std::format("{:>12} {:>8} {:>12.1f} {:>12.1f} {:>10}\n", "hash set", 1, setMs, mpix / setMs * 1000.0, set.size());
+
+    for (i32 const threads : {1, 2, 4, 0}) {
+        sw              = stopwatch::StartNew();
+        auto const hist {color_histogram::Build(img, threads)};
+        f64 const  ms {sw.elapsed_milliseconds()};
+        std::cout << std::format("{:>12} {:>8} {:>12.1f} {:>12.1f} {:>10}\n", "histogram", threads == 0 ? "all" : std::to_string(threads), ms, mpix / ms * 1000.0, hist.color_count());
+        if (hist.color_count() != std::ssize(set) || hist.pixel_count() != static_cast<i64>(size.Width) * size.Height) {
+            std::cout << "  histogram does not match\n";
+            ++failed;
+        }
+    }
+
+    // Wu from the histogram must match Wu on the pixels
+    if (wu_quant::GetPalette(color_histogram::Build(img, 0), 256) != wu_quant::GetPalette(img, 256)) {
+        std::cout << "  wu palette from histogram differs\n";
+        ++failed;
+    }
+    return failed;
+}
+
+// palette training time and the quality of a plain nearest mapping with that palette
+template <typename T>
+void bench_quantizer(string const& name, gfx::image const& img, i32 colors)
+{
+    auto       sw {stopwatch::StartNew()};
+    auto const pal {T::GetPalette(img, colors)};
+    f64 const  ms {sw.elapsed_milliseconds()};
+
+    palette_matcher const matcher {pal};
+    auto const            out {nearest_dither {matcher, 0}(img)};
+    f64 const             mse {mean_squared_error(img, out)};
+    std::cout << std::format("{:>10} {:>8} {:>12.1f} {:>10.2f} {:>10.2f}\n", name, colors, ms, mse, psnr(mse));
+}
+
+// palette training on a stratified subset: time vs quality of the nearest mapping
+template <typename T>
+void bench_sampling(string const& name, gfx::image const& img, i32 colors)
+{
+    for (f64 const rate : {1.0, 0.25, 0.05, 0.01}) {
+        auto       sw {stopwatch::StartNew()};
+        auto const training {make_training_image(img, rate, 0)};
+        auto const pal {T::GetPalette(training ? *training : img, colors)};
+        f64 const  ms {sw.elapsed_milliseconds()};
+
+        palette_matcher const matcher {pal};
+        f64 const             mse {mean_squared_error(img, nearest_dither {matcher, 0}(img))};
+        std::cout << std::format("{:>10} {:>8.2f} {:>12.1f} {:>10.2f} {:>10.2f}\n", name, rate, ms, mse, psnr(mse));
+    }
+}
+
+// matching in Oklab and CIELAB against RGB: conversion speed, search consistency and the
+// quality of the dithered result, measured as PSNR/SSIM in RGB and as CIE76 delta E
+auto bench_color_spaces(gfx::image const& img) -> i32
+{
+    i32        failed {0};
+    auto const size {img.info().Size};
+    f64 const  mpix {static_cast<f64>(size.Width) * size.Height / 1.0e6};
+    auto const data {img.data()};
+
+    std::vector<color> pixels(static_cast<usize>(size.Width) * static_cast<usize>(size.Height));
+    for (usize i {0}; i < pixels.size(); ++i) { pixels[i] = {data[i * 3], data[(i * 3) + 1], data[(i * 3) + 2], 255}; }
+    std::vector<std::array<i32, 3>> coords(pixels.size());
+
+    std::cout << std::format("{:>8} {:>14} {:>14}\n", "space", "batch Mpix/s", "single Mpix/s");
+    for (auto const space : {color_space::Oklab, color_space::CIELAB}) {
+        auto sw {stopwatch::StartNew()};
+        convert_colors(space, pixels, coords);
+        f64 const batchMs {sw.elapsed_milliseconds()};
+
+        sw         = stopwatch::StartNew();
+        isize differ {0};
+        for (usize i {0}; i < pixels.size(); ++i) {
+            if (convert_color(space, pixels[i].R, pixels[i].G, pixels[i].B) != coords[i]) { ++differ; }
+        }
+        f64 const singleMs {sw.elapsed_milliseconds()};
+        std::cout << std::format("{:>8} {:>14.1f} {:>14.1f}\n", get_color_space_name(space), mpix / batchMs * 1000.0, mpix / singleMs * 1000.0);
+        if (differ > 0) {
+            std::cout << std::format("  {} single conversions differ from the batch\n", differ);
+            ++failed;
+        }
+    }
+
+    std::cout << std::format("\n{:>8} {:>8} {:>16} {:>10} {:>10} {:>10} {:>8}\n", "space", "colors", "dithering", "Mpix/s", "PSNR", "SSIM", "deltaE");
+    for (i32 const colors : {16, 64, 256}) {
+        auto const pal {wu_quant::GetPalette(color_histogram::Build(img, 0), colors)};
+        for (auto const space : {color_space::RGB, color_space::Oklab, color_space::CIELAB}) {
+            palette_matcher const matcher {pal, space};
+
+            // all search paths have to agree in every color space
+            convert_colors(space, pixels, coords);
+            isize mismatch {0};
+            for (usize i {0}; i < coords.size(); i += 7) {
+                auto const& c {coords[i]};
+                i32 const   ref {matcher.nearest_scalar(c[0], c[1], c[2])};
+                if (matcher.nearest_linear(c[0], c[1], c[2]) != ref || matcher.nearest_indexed(c[0], c[1], c[2]) != ref) { ++mismatch; }
+            }
+            if (mismatch > 0) {
+                std::cout << std::format("  mismatch between search results for {} colors in {}\n", colors, get_color_space_name(space));
+                ++failed;
+            }
+
+            for (string const dithering : {"none", "floyd-steinberg"}) {
+                auto       sw {stopwatch::StartNew()};
+                auto const out {dither_image(img, matcher, dithering, 0)};
+                f64 const  ms {sw.elapsed_milliseconds()};
+                std::cout << std::format("{:>8} {:>8} {:>16} {:>10.1f} {:>10.2f} {:>10.4f} {:>8.2f}\n", get_color_space_name(space), colors, dithering,
+                                         mpix / ms * 1000.0, psnr(mean_squared_error(img, out)), ssim(img, out), mean_delta_e(img, out));
+            }
+        }
+    }
+    return failed;
+}
+
+auto run_kernels() -> i32
+{
+    std::mt19937     rng {12345};
+    size_i const     size {3840, 2160};
+    auto const       img {make_image(size, rng)};
+    f64 const        mpix {static_cast<f64>(size.Width) * size.Height / 1.0e6};
+    std::vector<i32> scalar(static_cast<usize>(size.Width * size.Height));
+    std::vector<i32> linear(scalar.size());
+    std::vector<i32> indexed(scalar.size());
+    std::vector<i32> fixed(scalar.size());
+
+    // scalar: brute force reference, simd: vectorized brute force, kd-tree: palette index,
+    // fixed: compile-time sized brute force padded to 2, 4, 16 or 256 entries
+    std::cout << std::format("nearest color search, {}x{} image, Mpix/s\n", size.Width, size.Height);
+    std::cout << std::format("{:>8} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n", "colors", "scalar", "simd", "kd-tree", "fixed", "best", "dither");
+
+    i32 failed {0};
+    for (i32 const colors : {2, 4, 8, 16, 32, 64, 96, 128, 130, 192, 256, 512, 1024}) {
+        palette_matcher const matcher {make_palette(colors, rng)};
+
+        f64 const scalarMs {run(img, scalar, [&](i32 r, i32 g, i32 b) { return matcher.nearest_scalar(r, g, b); })};
+        f64 const linearMs {run(img, linear, [&](i32 r, i32 g, i32 b) { return matcher.nearest_linear(r, g, b); })};
+        f64 const indexedMs {run(img, indexed, [&](i32 r, i32 g, i32 b) { return matcher.nearest_indexed(r, g, b); })};
+        f64       fixedMs {std::numeric_limits<f64>::infinity()};
+        if (colors <= 2) {
+            fixedMs = run_fixed<2>(img, fixed, matcher);
+        } else if (colors <= 4) {
+            fixedMs = run_fixed<4>(img, fixed, matcher);
+        } else if (colors <= 16) {
+            fixedMs = run_fixed<16>(img, fixed, matcher);
+        } else if (colors <= 256) {
+            fixedMs = run_fixed<256>(img, fixed, matcher);
+        }
+
+        auto       sw {stopwatch::StartNew()};
+        auto const dithered {nearest_dither {matcher, 1}(img)};
+        f64 const  ditherMs {sw.elapsed_milliseconds()};
+
+        f64 const bestMs {std::min({linearMs, indexedMs, fixedMs})};
+        std::cout << std::format("{:>8} {:>10.1f} {:>10.1f} {:>10.1f} {:>10} {:>10} {:>10.1f}\n",
+                                 colors, mpix / scalarMs * 1000.0, mpix / linearMs * 1000.0, mpix / indexedMs * 1000.0,
+                                 colors <= 256 ? std::format("{:.1f}", mpix / fixedMs * 1000.0) : "-",
+                                 bestMs == fixedMs ? "fixed" : bestMs == indexedMs ? "kd-tree" : "simd", mpix / ditherMs * 1000.0);
+
+        if (scalar != linear || scalar != indexed || (colors <= 256 && scalar != fixed)) {
+            std::cout << std::format("  mismatch between search results for {} colors\n", colors);
+            ++failed;
+        }
+    }
+
+    std::cout << std::format("\ncolor spaces, {}x{} image\n", size.Width, size.Height);
+    failed += bench_color_spaces(img);
+
+    std::cout << std::format("\ninverse colormap\n");
+    std::cout << std::format("{:>8} {:>6} {:>7} {:>10} {:>12} {:>10} {:>12}\n", "colors", "cells", "mode", "build ms", "ambiguous", "Mpix/s", "differ");
+    for (i32 const colors : {16, 64, 256}) {
+        palette_matcher const matcher {make_palette(colors, rng)};
+        run(img, scalar, [&](i32 r, i32 g, i32 b) { return matcher.nearest_scalar(r, g, b); });
+        failed += bench_colormap(img, scalar, matcher, colors, mpix);
+    }
+
+    palette_matcher const threadMatcher {make_palette(256, rng)};
+    std::cout << std::format("\nordered dithering, {}x{} image, 256 colors\n", size.Width, size.Height);
+    std::cout << std::format("{:>16} {:>8} {:>12} {:>12} {:>8}\n", "dithering", "threads", "ms", "Mpix/s", "speedup");
+    failed += bench_threads("bayer8", img, [&](i32 threads) { return bayer_dither {threadMatcher, gfx::bayer_matrix::Bayer8x8, threads}; });
+    failed += bench_threads("noise8", img, [&](i32 threads) { return value_noise_dither {threadMatcher, size / 8, threads}; });
+
+    size_i const large {7680, 4320};
+    auto const   largeImg {make_image(large, rng)};
+    std::cout << std::format("\nerror diffusion, {}x{} image, 256 colors\n", large.Width, large.Height);
+    std::cout << std::format("{:>16} {:>8} {:>12} {:>12} {:>8}\n", "dithering", "threads", "ms", "Mpix/s", "speedup");
+    failed += bench_threads("floyd-steinberg", largeImg, [&](i32 threads) { return floyd_steinberg_dither {threadMatcher, threads}; });
+    failed += bench_threads("atkinson", largeImg, [&](i32 threads) { return atkinson_dither {threadMatcher, threads}; });
+
+    std::cout << std::format("\ncolor histogram, {}x{} image\n", size.Width, size.Height);
+    std::cout << std::format("{:>12} {:>8} {:>12} {:>12} {:>10}\n", "method", "threads", "ms", "Mpix/s", "colors");
+    failed += bench_histogram(img);
+
+    std::cout << std::format("\nquantizers, {}x{} image\n", size.Width, size.Height);
+    std::cout << std::format("{:>10} {:>8} {:>12} {:>10} {:>10}\n", "quantizer", "colors", "palette ms", "MSE", "PSNR");
+    for (i32 const colors : {16, 64, 256}) {
+        bench_quantizer<gfx::neuquant>("neuquant", img, colors);
+        bench_quantizer<gfx::octree_quant>("octree", img, colors);
+        bench_quantizer<wu_quant>("wu", img, colors);
+    }
+
+    std::cout << std::format("\nsampled training, {}x{} image, 256 colors\n", size.Width, size.Height);
+    std::cout << std::format("{:>10} {:>8} {:>12} {:>10} {:>10}\n", "quantizer", "rate", "palette ms", "MSE", "PSNR");
+    bench_sampling<gfx::neuquant>("neuquant", img, 256);
+    bench_sampling<gfx::octree_quant>("octree", img, 256);
+
+    return failed == 0 ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////
+
+// flat rectangles in a few colors, like UI art or sprites
+auto make_blocks_image(size_i size, std::mt19937& rng) -> gfx::image
+{
+    auto       img {gfx::image::CreateEmpty(size, gfx::image::format::RGB)};
+    auto const colors {make_palette(24, rng)};
+    auto       data {img.data()};
+
+    std::uniform_int_distribution<i32> pick {0, static_cast<i32>(colors.size()) - 1};
+    std::uniform_int_distribution<i32> posX {0, size.Width - 1};
+    std::uniform_int_distribution<i32> posY {0, size.Height - 1};
+    for (i32 i {0}; i < 200; ++i) {
+        i32 const   x0 {posX(rng)};
+        i32 const   y0 {posY(rng)};
+        i32 const   x1 {std::min(size.Width, x0 + 1 + (posX(rng) / 3))};
+        i32 const   y1 {std::min(size.Height, y0 + 1 + (posY(rng) / 3))};
+        color const c {colors[static_cast<usize>(pick(rng))]};
+        for (i32 y {y0}; y < y1; ++y) {
+            for (i32 x {x0}; x < x1; ++x) {
+                u8* p {data.data() + (((static_cast<isize>(y) * size.Width) + x) * 3)};
+                p[0] = c.R;
+                p[1] = c.G;
+                p[2] = c.B;
+            }
+        }
+    }
+    return img;
+}
+
+struct matrix_options {
+    std::vector<string>      Quantizers;
+    std::vector<string>      Ditherings;
+    std::vector<color_space> ColorSpaces;
+    std::vector<i32>         Colors;
+    std::vector<size_i>      Sizes;
+    string                   Corpus;
+    i32                      Warmup {1};
+    i32                      Repeat {5};
+    i32                      Threads {0};
+    string                   CsvFile;
+    string                   JsonFile;
+};
+
+struct timing {
+    f64 Median {0};
+    f64 P95 {0};
+};
+
+struct matrix_result {
+    string      Image;
+    size_i      Size;
+    string      Quantizer;
+    i32         Colors {0};
+    string      Dithering;
+    color_space ColorSpace {color_space::RGB};
+    timing      Palette;
+    timing      Dither;
+    f64         MpixPerSecond {0};
+    f64         Mse {0};
+    f64         Psnr {0};
+    f64         Ssim {0};
+    f64         DeltaE {0};
+};
+
+// nearest-rank percentiles
+auto get_timing(std::vector<f64> samples) -> timing
+{
+    if (samples.empty()) { return {}; }
+    std::ranges::sort(samples);
+    usize const p95 {static_cast<usize>(std::ceil(0.95 * static_cast<f64>(samples.size()))) - 1};
+    return {.Median = samples[(samples.size() - 1) / 2], .P95 = samples[p95]};
+}
+
+// the last result is kept, all repetitions are expected to produce the same one
+template <typename Func>
+auto measure(i32 warmup, i32 repeat, Func&& func) -> std::pair<timing, decltype(func())>
+{
+    for (i32 i {0}; i < warmup; ++i) { func(); }
+
+    std::vector<f64> samples;
+    decltype(func()) retValue {};
+    for (i32 i {0}; i < std::max(1, repeat); ++i) {
+        auto sw {stopwatch::StartNew()};
+        retValue = func();
+        samples.push_back(sw.elapsed_milliseconds());
+    }
+    return {get_timing(std::move(samples)), std::move(retValue)};
+}
+
+// as doQuant trains: wu from the histogram, the others from the pixels
+auto train(string const& quantizer, gfx::image const& img, i32 colors, i32 threads) -> std::vector<color>
+{
+    if (quantizer == "wu") { return wu_quant::GetPalette(color_histogram::Build(img, threads), colors); }
+    if (quantizer == "neuquant") { return gfx::neuquant::GetPalette(img, colors); }
+    return gfx::octree_quant::GetPalette(img, colors);
+}
+
+void write_csv(std::ostream& out, std::span<matrix_result const> results)
+{
+    out << "image,width,height,quantizer,colors,dithering,color_space,palette_median_ms,palette_p95_ms,dither_median_ms,dither_p95_ms,mpix_per_s,mse,psnr,ssim,delta_e\n";
+    for (auto const& r : results) {
+        out << std::format("{},{},{},{},{},{},{},{:.3f},{:.3f},{:.3f},{:.3f},{:.2f},{:.3f},{:.3f},{:.5f},{:.3f}\n",
+                           r.Image, r.Size.Width, r.Size.Height, r.Quantizer, r.Colors, r.Dithering, get_color_space_name(r.ColorSpace),
+                           r.Palette.Median, r.Palette.P95, r.Dither.Median, r.Dither.P95, r.MpixPerSecond, r.Mse, r.Psnr, r.Ssim, r.DeltaE);
+    }
+}
+
+void write_json(std::ostream& out, std::span<matrix_result const> results)
+{
+    auto const quote {[](string const& str) {
+        string retValue {"\""};
+        for (char const c : str) {
+            if (c == '"' || c == '\\') { retValue += '\\'; }
+            retValue += c;
+        }
+        return retValue + "\"";
+    }};
+    // infinite PSNR (lossless) has no JSON representation
+    auto const number {[](f64 value) { return std::isfinite(value) ? std::format("{:.3f}", value) : string {"null"}; }};
+
+    out << "[\n";
+    for (usize i {0}; i < results.size(); ++i) {
+        auto const& r {results[i]};
+        out << std::format("  {{\"image\": {}, \"width\": {}, \"height\": {}, \"quantizer\": {}, \"colors\": {}, \"dithering\": {}, \"color_space\": {}, "
+                           "\"palette_ms\": {{\"median\": {:.3f}, \"p95\": {:.3f}}}, \"dither_ms\": {{\"median\": {:.3f}, \"p95\": {:.3f}}}, "
+                           "\"mpix_per_s\": {:.2f}, \"mse\": {:.3f}, \"psnr\": {}, \"ssim\": {:.5f}, \"delta_e\": {:.3f}}}{}\n",
+                           quote(r.Image), r.Size.Width, r.Size.Height, quote(r.Quantizer), r.Colors, quote(r.Dithering), quote(get_color_space_name(r.ColorSpace)),
+                           r.Palette.Median, r.Palette.P95, r.Dither.Median, r.Dither.P95,
+                           r.MpixPerSecond, r.Mse, number(r.Psnr), r.Ssim, r.DeltaE, i + 1 < results.size() ? "," : "");
+    }
+    out << "]\n";
+}
+
+// palettes are trained once per image, quantizer and color count and shared by all ditherings
+auto run_matrix(matrix_options const& opts) -> i32
+{
+    std::mt19937 rng {12345};
+
+    std::vector<std::pair<string, gfx::image>> images;
+    for (auto const& size : opts.Sizes) {
+        images.emplace_back(std::format("gradient-{}x{}", size.Width, size.Height), make_image(size, rng));
+        images.emplace_back(std::format("blocks-{}x{}", size.Width, size.Height), make_blocks_image(size, rng));
+    }
+    if (!opts.Corpus.empty()) {
+        for (auto const& file : io::enumerate(opts.Corpus, {.String = "*.png"})) {
+            auto img {gfx::image::Load(file)};
+            if (!img) { return print_error("error loading image: " + file); }
+            images.emplace_back(io::get_stem(file), std::move(*img));
+        }
+    }
+
+    std::cout << std::format("{} images, {} warmup, {} repetitions, median/p95 in ms\n", images.size(), opts.Warmup, opts.Repeat);
+    std::cout << std::format("{:<22} {:>9} {:>6} {:>16} {:>6} {:>17} {:>17} {:>9} {:>8} {:>7} {:>7}\n",
+                             "image", "quantizer", "colors", "dithering", "space", "palette", "dither", "Mpix/s", "PSNR", "SSIM", "deltaE");
+
+    std::vector<matrix_result> results;
+    for (auto const& [name, img] : images) {
+        auto const size {img.info().Size};
+        f64 const  mpix {static_cast<f64>(size.Width) * size.Height / 1.0e6};
+
+        for (auto const& quantizer : opts.Quantizers) {
+            for (i32 const colors : opts.Colors) {
+                auto const [paletteTime, pal] {measure(opts.Warmup, opts.Repeat, [&] { return train(quantizer, img, colors, opts.Threads); })};
+
+                for (auto const space : opts.ColorSpaces) {
+                    palette_matcher const matcher {pal, space};
+
+                    for (auto const& dithering : opts.Ditherings) {
+                        auto const [ditherTime, out] {measure(opts.Warmup, opts.Repeat, [&] { return dither_image(img, matcher, dithering, opts.Threads); })};
+                        f64 const mse {mean_squared_error(img, out)};
+
+                        matrix_result r {
+                            .Image         = name,
+                            .Size          = size,
+                            .Quantizer     = quantizer,
+                            .Colors        = colors,
+                            .Dithering     = dithering,
+                            .ColorSpace    = space,
+                            .Palette       = paletteTime,
+                            .Dither        = ditherTime,
+                            .MpixPerSecond = ditherTime.Median > 0 ? mpix / ditherTime.Median * 1000.0 : 0.0,
+                            .Mse           = mse,
+                            .Psnr          = psnr(mse),
+                            .Ssim          = ssim(img, out),
+                            .DeltaE        = mean_delta_e(img, out)};
+
+                        std::cout << std::format("{:<22} {:>9} {:>6} {:>16} {:>6} {:>8.1f}/{:<8.1f} {:>8.1f}/{:<8.1f} {:>9.1f} {:>8.2f} {:>7.4f} {:>7.2f}\n",
+                                                 r.Image, r.Quantizer, r.Colors, r.Dithering, get_color_space_name(r.ColorSpace), r.Palette.Median, r.Palette.P95,
+                                                 r.Dither.Median, r.Dither.P95, r.MpixPerSecond, r.Psnr, r.Ssim, r.DeltaE);
+                        results.push_back(std::move(r));
+                    }
+                }
+            }
+        }
+    }
+
+    if (!opts.CsvFile.empty()) {
+        std::ofstream out {opts.CsvFile, std::ios::trunc};
+        write_csv(out, results);
+        if (!out) { return print_error("error writing " + opts.CsvFile); }
+    }
+    if (!opts.JsonFile.empty()) {
+        std::ofstream out {opts.JsonFile, std::ios::trunc};
+        write_json(out, results);
+        if (!out) { return print_error("error writing " + opts.JsonFile); }
+    }
+    return 0;
+}
+
+auto parse_size(string const& str) -> std::optional<size_i>
+{
+    i32 width {0};
+    i32 height {0};
+    if (std::sscanf(str.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) { return std::nullopt; }
+    return size_i {width, height};
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+    argparse::ArgumentParser program("quant_bench");
+
+    program.add_argument("--matrix")
+        .help("run the quantizer x dithering x colors x size matrix instead of the kernel benchmarks")
+        .flag();
+
+    program.add_argument("--quantizers")
+        .help("quantizers in the matrix")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .default_value(std::vector<string> {"neuquant", "octree", "wu"});
+
+    program.add_argument("--dithering")
+        .help("dithering algorithms in the matrix")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .default_value(std::vector<string> {"none", "bayer8", "noise8", "floyd-steinberg", "atkinson"});
+
+    program.add_argument("--color-spaces")
+        .help("matching color spaces in the matrix: rgb, oklab, lab")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .default_value(std::vector<string> {"rgb"});
+
+    program.add_argument("--colors")
+        .help("palette sizes in the matrix")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .default_value(std::vector<i32> {16, 64, 256})
+        .scan<'i', i32>();
+
+    program.add_argument("--sizes")
+        .help("sizes of the synthetic images, WIDTHxHEIGHT")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .default_value(std::vector<string> {"512x512", "1920x1080", "3840x2160"});
+
+    program.add_argument("--corpus")
+        .help("folder of png images to add to the synthetic ones")
+        .default_value("")
+        .metavar("FOLDER");
+
+    program.add_argument("--warmup")
+        .help("untimed runs before measuring")
+        .default_value(1)
+        .scan<'i', i32>()
+        .metavar("N");
+
+    program.add_argument("--repeat")
+        .help("timed runs per case")
+        .default_value(5)
+        .scan<'i', i32>()
+        .metavar("N");
+
+    program.add_argument("-j", "--threads")
+        .help("number of threads, 0 uses all cores")
+        .default_value(0)
+        .scan<'i', i32>()
+        .metavar("N");
+
+    program.add_argument("--csv")
+        .help("write the matrix results as CSV")
+        .default_value("")
+        .metavar("FILE");
+
+    program.add_argument("--json")
+        .help("write the matrix results as JSON")
+        .default_value("")
+        .metavar("FILE");
+
+    auto pl {platform::HeadlessInit()};
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (std::exception const& err) {
+        std::cout << err.what() << '\n';
+        std::cout << program;
+        return 1;
+    }
+
+    if (!program.get<bool>("--matrix")) { return run_kernels(); }
+
+    matrix_options opts {
+        .Quantizers  = program.get<std::vector<string>>("--quantizers"),
+        .Ditherings  = program.get<std::vector<string>>("--dithering"),
+        .ColorSpaces = {},
+        .Colors      = program.get<std::vector<i32>>("--colors"),
+        .Sizes       = {},
+        .Corpus      = program.get<string>("--corpus"),
+        .Warmup      = std::max(0, program.get<i32>("--warmup")),
+        .Repeat      = std::max(1, program.get<i32>("--repeat")),
+        .Threads     = program.get<i32>("--threads"),
+        .CsvFile     = program.get<string>("--csv"),
+        .JsonFile    = program.get<string>("--json")};
+    for (auto const& str : program.get<std::vector<string>>("--color-spaces")) {
+        auto const space {parse_color_space(str)};
+        if (!space) { return print_error("invalid color space: " + str); }
+        opts.ColorSpaces.push_back(*space);
+    }
+    for (auto const& str : program.get<std::vector<string>>("--sizes")) {
+        auto const size {parse_size(str)};
+        if (!size) { return print_error("invalid size: " + str); }
+        opts.Sizes.push_back(*size);
+    }
+    for (auto& dithering : opts.Ditherings) {
+        // validated here, argparse choices don't combine with a variable number of values
+        if (std::ranges::find(DITHERINGS, dithering) == DITHERINGS.end()) { return print_error("invalid dithering: " + dithering); }
+        if (dithering == "fs") { dithering = "floyd-steinberg"; }
+    }
+
+    return run_matrix(opts);
+}
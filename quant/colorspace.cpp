@@ -0,0 +1,218 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+#include <bit>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define QUANT_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define QUANT_SSE2
+#endif
+
+namespace {
+
+// colors per conversion step
+constexpr usize LANES {4};
+
+// first guess for the float cube root: a third of the exponent, see Kahan's cbrt
+constexpr i32 CBRT_MAGIC {0x2A5137A0};
+
+// sRGB -> linear -> three intermediate components -> nonlinearity -> three output coordinates
+struct conversion {
+    // decoded sRGB value times the first matrix, one table per channel; the 4th lane is padding
+    std::array<std::array<f32, 4>, 256> R {};
+    std::array<std::array<f32, 4>, 256> G {};
+    std::array<std::array<f32, 4>, 256> B {};
+
+    // x > Threshold ? cbrt(x) : Slope * x + Offset
+    f32 Threshold {0};
+    f32 Slope {0};
+    f32 Offset {0};
+
+    // second matrix and bias, output scale included
+    std::array<std::array<f32, 3>, 3> Matrix {};
+    std::array<f32, 3>                Bias {};
+};
+
+auto make_conversion(std::array<std::array<f64, 3>, 3> const& first) -> conversion
+{
+    conversion retValue;
+    for (i32 v {0}; v < 256; ++v) {
+        f64 const c {v / 255.0};
+        f64 const linear {c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4)};
+        for (usize k {0}; k < 3; ++k) {
+            retValue.R[v][k] = static_cast<f32>(first[k][0] * linear);
+            retValue.G[v][k] = static_cast<f32>(first[k][1] * linear);
+            retValue.B[v][k] = static_cast<f32>(first[k][2] * linear);
+        }
+    }
+    return retValue;
+}
+
+auto get_oklab() -> conversion const&
+{
+    // https://bottosson.github.io/posts/oklab/
+    static conversion const retValue {[] {
+        auto conv {make_conversion({{{0.4122214708, 0.5363325363, 0.0514459929},
+                                     {0.2119034982, 0.6806995451, 0.1073969566},
+                                     {0.0883024619, 0.2817188376, 0.6299787005}}})};
+        std::array<std::array<f64, 3>, 3> const second {{{0.2104542553, 0.7936177850, -0.0040720468},
+                                                         {1.9779984951, -2.4285922050, 0.4505937099},
+                                                         {0.0259040371, 0.7827717662, -0.8086757660}}};
+        for (usize k {0}; k < 3; ++k) {
+            for (usize j {0}; j < 3; ++j) { conv.Matrix[k][j] = static_cast<f32>(second[k][j] * OKLAB_SCALE); }
+        }
+        return conv;
+    }()};
+    return retValue;
+}
+
+auto get_cielab() -> conversion const&
+{
+    // sRGB to XYZ, each row divided by the D65 white point
+    static conversion const retValue {[] {
+        auto conv {make_conversion({{{0.4124564 / 0.95047, 0.3575761 / 0.95047, 0.1804375 / 0.95047},
+                                     {0.2126729, 0.7151522, 0.0721750},
+                                     {0.0193339 / 1.08883, 0.1191920 / 1.08883, 0.9503041 / 1.08883}}})};
+        conv.Threshold = 216.0f / 24389.0f;
+        conv.Slope     = 24389.0f / 27.0f / 116.0f;
+        conv.Offset    = 16.0f / 116.0f;
+        // L = 116 fy - 16, a = 500 (fx - fy), b = 200 (fy - fz)
+        conv.Matrix = {{{0.0f, 116.0f * CIELAB_SCALE, 0.0f},
+                        {500.0f * CIELAB_SCALE, -500.0f * CIELAB_SCALE, 0.0f},
+                        {0.0f, 200.0f * CIELAB_SCALE, -200.0f * CIELAB_SCALE}}};
+        conv.Bias   = {-16.0f * CIELAB_SCALE, 0.0f, 0.0f};
+        return conv;
+    }()};
+    return retValue;
+}
+
+// converts up to LANES colors; unused lanes are converted too and ignored by the caller
+#if defined(QUANT_SSE2)
+void convert(conversion const& conv, std::span<color const, LANES> colors, std::array<std::array<f32, LANES>, 3>& out)
+{
+    auto const sum {[&](color const& c) {
+        return _mm_add_ps(_mm_add_ps(_mm_loadu_ps(conv.R[c.R].data()), _mm_loadu_ps(conv.G[c.G].data())), _mm_loadu_ps(conv.B[c.B].data()));
+    }};
+    __m128 x {sum(colors[0])};
+    __m128 y {sum(colors[1])};
+    __m128 z {sum(colors[2])};
+    __m128 w {sum(colors[3])};
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+
+    __m128 const  third {_mm_set1_ps(1.0f / 3.0f)};
+    __m128i const magic {_mm_set1_epi32(CBRT_MAGIC)};
+    auto const    nonlinear {[&](__m128 v) {
+        __m128 root {_mm_castsi128_ps(_mm_add_epi32(_mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(v)), third)), magic))};
+        for (i32 i {0}; i < 3; ++i) {
+            root = _mm_mul_ps(third, _mm_add_ps(_mm_add_ps(root, root), _mm_div_ps(v, _mm_mul_ps(root, root))));
+        }
+        __m128 const line {_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(conv.Slope)), _mm_set1_ps(conv.Offset))};
+        __m128 const mask {_mm_cmpgt_ps(v, _mm_set1_ps(conv.Threshold))};
+        return _mm_or_ps(_mm_and_ps(mask, root), _mm_andnot_ps(mask, line));
+    }};
+    __m128 const fx {nonlinear(x)};
+    __m128 const fy {nonlinear(y)};
+    __m128 const fz {nonlinear(z)};
+
+    for (usize k {0}; k < 3; ++k) {
+        auto const& m {conv.Matrix[k]};
+        __m128      v {_mm_add_ps(_mm_set1_ps(conv.Bias[k]), _mm_mul_ps(_mm_set1_ps(m[0]), fx))};
+        v = _mm_add_ps(_mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(m[1]), fy)), _mm_mul_ps(_mm_set1_ps(m[2]), fz));
+        _mm_storeu_ps(out[k].data(), v);
+    }
+}
+#else
+void convert(conversion const& conv, std::span<color const, LANES> colors, std::array<std::array<f32, LANES>, 3>& out)
+{
+    auto const nonlinear {[&](f32 v) {
+        if (!(v > conv.Threshold)) { return (v * conv.Slope) + conv.Offset; }
+        f32 root {std::bit_cast<f32>(static_cast<i32>(static_cast<f32>(std::bit_cast<i32>(v)) * (1.0f / 3.0f)) + CBRT_MAGIC)};
+        for (i32 i {0}; i < 3; ++i) { root = (1.0f / 3.0f) * ((root + root) + (v / (root * root))); }
+        return root;
+    }};
+
+    for (usize i {0}; i < LANES; ++i) {
+        color const&             c {colors[i]};
+        std::array<f32, 3> const f {nonlinear((conv.R[c.R][0] + conv.G[c.G][0]) + conv.B[c.B][0]),
+                                    nonlinear((conv.R[c.R][1] + conv.G[c.G][1]) + conv.B[c.B][1]),
+                                    nonlinear((conv.R[c.R][2] + conv.G[c.G][2]) + conv.B[c.B][2])};
+        for (usize k {0}; k < 3; ++k) {
+            f32 v {conv.Bias[k]};
+            for (usize j {0}; j < 3; ++j) { v += conv.Matrix[k][j] * f[j]; }
+            out[k][i] = v;
+        }
+    }
+}
+#endif
+
+template <typename T, typename Store>
+void convert_all(color_space space, std::span<color const> colors, std::span<std::array<T, 3>> out, Store&& store)
+{
+    if (space == color_space::RGB) {
+        for (usize i {0}; i < colors.size(); ++i) {
+            out[i] = {static_cast<T>(colors[i].R), static_cast<T>(colors[i].G), static_cast<T>(colors[i].B)};
+        }
+        return;
+    }
+
+    conversion const&                     conv {space == color_space::Oklab ? get_oklab() : get_cielab()};
+    std::array<std::array<f32, LANES>, 3> values {};
+    for (usize i {0}; i < colors.size(); i += LANES) {
+        usize const count {std::min(LANES, colors.size() - i)};
+        if (count == LANES) {
+            convert(conv, colors.subspan(i).first<LANES>(), values);
+        } else {
+            std::array<color, LANES> tail {};
+            std::copy_n(colors.begin() + static_cast<isize>(i), count, tail.begin());
+            convert(conv, tail, values);
+        }
+        for (usize l {0}; l < count; ++l) { out[i + l] = {store(values[0][l]), store(values[1][l]), store(values[2][l])}; }
+    }
+}
+
+}
+
+////////////////////////////////////////////////////////////
+
+auto parse_color_space(string const& name) -> std::optional<color_space>
+{
+    if (name == "rgb") { return color_space::RGB; }
+    if (name == "oklab") { return color_space::Oklab; }
+    if (name == "lab") { return color_space::CIELAB; }
+    return std::nullopt;
+}
+
+auto get_color_space_name(color_space space) -> string
+{
+    switch (space) {
+    case color_space::RGB: return "rgb";
+    case color_space::Oklab: return "oklab";
+    case color_space::CIELAB: return "lab";
+    }
+    return "";
+}
+
+void convert_colors(color_space space, std::span<color const> colors, std::span<std::array<f32, 3>> out)
+{
+    convert_all(space, colors, out, [](f32 v) { return v; });
+}
+
+void convert_colors(color_space space, std::span<color const> colors, std::span<std::array<i32, 3>> out)
+{
+    convert_all(space, colors, out, [](f32 v) { return static_cast<i32>(std::lrint(v)); });
+}
+
+auto convert_color(color_space space, i32 r, i32 g, i32 b) -> std::array<i32, 3>
+{
+    color const        c {static_cast<u8>(r), static_cast<u8>(g), static_cast<u8>(b), 255};
+    std::array<i32, 3> retValue {};
+    convert_colors(space, {&c, 1}, {&retValue, 1});
+    return retValue;
+}
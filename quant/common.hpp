@@ -0,0 +1,434 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <tcob/tcob.hpp>
+
+using namespace tcob;
+namespace io = tcob::io;
+
+enum class color_space : u8 {
+    RGB,
+    Oklab,
+    CIELAB
+};
+
+struct options {
+    i32         Colors {256};
+    string      Dithering {"none"};
+    i32         ColormapBits {0};
+    bool        ColormapExact {false};
+    i32         Threads {0};
+    f64         SampleRate {1.0};
+    i64         MaxSamples {0};
+    string      PaletteFile;
+    string      SavePalette;
+    bool        Indexed {false};
+    i32         TileRows {0};
+    color_space ColorSpace {color_space::RGB};
+    bool        Animation {false};
+    i32         PaletteWindow {0};
+    i32         FrameDelay {100};
+    i32         Refine {0};
+};
+
+////////////////////////////////////////////////////////////
+
+// coordinates are scaled so squared distances between colors stay below 2^20, as they do in RGB
+constexpr f32 OKLAB_SCALE {400.0f};
+constexpr f32 CIELAB_SCALE {2.0f};
+
+auto parse_color_space(string const& name) -> std::optional<color_space>;
+auto get_color_space_name(color_space space) -> string;
+
+// sRGB to scaled color space coordinates, RGB passes through; sRGB decoding and the first matrix
+// are folded into per-channel tables, the cube roots and the second matrix run four colors per SIMD step
+void convert_colors(color_space space, std::span<color const> colors, std::span<std::array<f32, 3>> out);
+void convert_colors(color_space space, std::span<color const> colors, std::span<std::array<i32, 3>> out);
+auto convert_color(color_space space, i32 r, i32 g, i32 b) -> std::array<i32, 3>;
+
+////////////////////////////////////////////////////////////
+
+// nearest palette color search, palette stored as SoA for SIMD and as a k-d tree for large palettes
+class palette_matcher {
+public:
+    explicit palette_matcher(std::span<color const> palette, color_space space = color_space::RGB);
+
+    auto colors() const -> std::span<color const>;
+    auto size() const -> i32;
+    auto space() const -> color_space;
+
+    // index of the nearest color to an sRGB color by squared distance in the matcher's color space,
+    // lowest index wins ties
+    auto nearest(i32 r, i32 g, i32 b) const -> i32;
+
+    // searches by coordinates of the matcher's color space, see convert_color()
+    auto nearest_scalar(i32 x, i32 y, i32 z) const -> i32;
+    auto nearest_linear(i32 x, i32 y, i32 z) const -> i32;
+    auto nearest_indexed(i32 x, i32 y, i32 z) const -> i32;
+
+    // Builds a (2^bits)^3 lookup table from quantized RGB to palette index, used by nearest().
+    // Exact tables only keep cells with a unique nearest color and search the others;
+    // returns the number of those ambiguous cells. Outside RGB the distance is not linear within
+    // a cell, exact tables then search the cells whose corners disagree with their center and
+    // only miss colors that win in a small pocket inside a cell.
+    auto build_colormap(i32 bits, bool exact, i32 threads) -> isize;
+    auto has_colormap() const -> bool;
+    // whether searches without a colormap hit go through the k-d tree
+    auto has_index() const -> bool;
+
+private:
+    struct kd_entry {
+        i32 X;
+        i32 Y;
+        i32 Z;
+        i32 Index;
+    };
+
+    struct kd_node {
+        i32 Begin;
+        i32 End;
+        i32 Right; // -1 for leaves, the left child always follows its parent
+        i32 Axis;
+        i32 Split;
+    };
+
+    auto build_node(i32 begin, i32 end) -> i32;
+    void search_node(i32 node, std::array<i32, 3> const& query, i32& best, i32& bestDist) const;
+
+    std::vector<color>              _colors;
+    color_space                     _space;
+    std::vector<std::array<i32, 3>> _coords;
+    std::vector<f32>                _x;
+    std::vector<f32>                _y;
+    std::vector<f32>                _z;
+
+    std::vector<kd_entry> _entries;
+    std::vector<kd_node>  _nodes;
+    bool                  _useIndex {false};
+
+    std::vector<u16> _colormap;
+    i32              _colormapBits {0};
+
+    template <i32 N>
+    friend class fixed_palette_matcher;
+};
+
+// palette_matcher::nearest without a colormap, for palettes of up to N colors: the search runs a
+// trip count fixed at compile time, unrolled below one SIMD step. Instantiated for N = 2, 4, 16 and 256.
+template <i32 N>
+class fixed_palette_matcher {
+public:
+    explicit fixed_palette_matcher(palette_matcher const& matcher);
+
+    auto colors() const -> std::span<color const>;
+    auto size() const -> i32;
+
+    auto nearest(i32 r, i32 g, i32 b) const -> i32;
+
+private:
+    // padded to whole SIMD steps of 8 entries
+    static constexpr usize SLOTS {N < 8 ? N : ((N + 7) / 8) * 8};
+
+    std::span<color const> _colors;
+    color_space            _space;
+    std::array<f32, SLOTS> _x {};
+    std::array<f32, SLOTS> _y {};
+    std::array<f32, SLOTS> _z {};
+};
+
+////////////////////////////////////////////////////////////
+
+// state for dithering an image as a sequence of horizontal bands: ordered filters see image
+// coordinates and error diffusion carries its pending error rows into the next band, so the
+// result matches dithering the whole image at once
+struct dither_band {
+    size_i           ImageSize;
+    i32              Top {0}; // first row of the next band
+    std::vector<f32> Carry {};
+};
+
+// local ports of the gfx:: dither filters, all sharing one palette_matcher;
+// the ordered filters split the image into row bands, error diffusion runs rows as a wavefront;
+// threads <= 0 uses all cores; indices() skips the color image and stores palette indices only
+class nearest_dither {
+public:
+    nearest_dither(palette_matcher const& matcher, i32 threads);
+
+    auto operator()(gfx::image const& img) const -> gfx::image;
+    auto indices(gfx::image const& img) const -> std::vector<u8>;
+    auto indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>;
+
+private:
+    template <typename Sink>
+    void run(gfx::image const& img, Sink& sink, dither_band& band) const;
+
+    palette_matcher const& _matcher;
+    i32                    _threads;
+};
+
+class bayer_dither {
+public:
+    bayer_dither(palette_matcher const& matcher, gfx::bayer_matrix matrix, i32 threads);
+
+    auto operator()(gfx::image const& img) const -> gfx::image;
+    auto indices(gfx::image const& img) const -> std::vector<u8>;
+    auto indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>;
+
+private:
+    template <typename Sink>
+    void run(gfx::image const& img, Sink& sink, dither_band& band) const;
+
+    palette_matcher const& _matcher;
+    i32                    _size;
+    i32                    _threads;
+};
+
+class value_noise_dither {
+public:
+    value_noise_dither(palette_matcher const& matcher, size_i noiseSize, i32 threads);
+
+    auto operator()(gfx::image const& img) const -> gfx::image;
+    auto indices(gfx::image const& img) const -> std::vector<u8>;
+    auto indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>;
+
+private:
+    template <typename Sink>
+    void run(gfx::image const& img, Sink& sink, dither_band& band) const;
+
+    palette_matcher const& _matcher;
+    size_i                 _noiseSize;
+    i32                    _threads;
+};
+
+class floyd_steinberg_dither {
+public:
+    floyd_steinberg_dither(palette_matcher const& matcher, i32 threads);
+
+    auto operator()(gfx::image const& img) const -> gfx::image;
+    auto indices(gfx::image const& img) const -> std::vector<u8>;
+    auto indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>;
+
+private:
+    template <typename Sink>
+    void run(gfx::image const& img, Sink& sink, dither_band& band) const;
+
+    palette_matcher const& _matcher;
+    i32                    _threads;
+};
+
+class atkinson_dither {
+public:
+    atkinson_dither(palette_matcher const& matcher, i32 threads);
+
+    auto operator()(gfx::image const& img) const -> gfx::image;
+    auto indices(gfx::image const& img) const -> std::vector<u8>;
+    auto indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>;
+
+private:
+    template <typename Sink>
+    void run(gfx::image const& img, Sink& sink, dither_band& band) const;
+
+    palette_matcher const& _matcher;
+    i32                    _threads;
+};
+
+// filter names accepted on the command line; "fs" is short for "floyd-steinberg" and unknown
+// names fall back to no dithering
+constexpr std::array<std::string_view, 10> DITHERINGS {"none", "floyd-steinberg", "fs", "bayer2", "bayer4", "bayer8", "atkinson", "noise1", "noise8", "noise32"};
+
+// runs the filter named on the command line, e.g. "bayer4" or "floyd-steinberg"
+auto dither_image(gfx::image const& img, palette_matcher const& matcher, string const& dithering, i32 threads) -> gfx::image;
+// same, but stores one palette index byte per pixel instead; the palette may have at most 256 colors
+auto dither_indices(gfx::image const& img, palette_matcher const& matcher, string const& dithering, i32 threads) -> std::vector<u8>;
+// img is the next band of a larger image, see dither_band
+auto dither_indices(gfx::image const& img, palette_matcher const& matcher, string const& dithering, dither_band& band, i32 threads) -> std::vector<u8>;
+
+////////////////////////////////////////////////////////////
+
+// distinct colors of an image with their pixel counts, sorted by packed RGBA;
+// built per row band with a radix sort and merged, so it can stand in for count_colors()
+class color_histogram {
+public:
+    struct entry {
+        u32 Color; // RGBA, red in the high byte
+        u32 Count;
+
+        auto get_color() const -> color;
+    };
+
+    static auto Build(gfx::image const& img, i32 threads) -> color_histogram;
+    static auto Merge(std::span<color_histogram const> histograms) -> color_histogram;
+
+    auto entries() const -> std::span<entry const>;
+    auto color_count() const -> isize;
+    auto pixel_count() const -> i64;
+
+    // drops the colors below half alpha, which end up transparent in indexed output
+    void remove_transparent();
+
+private:
+    std::vector<entry> _entries;
+    i64                _pixelCount {0};
+};
+
+////////////////////////////////////////////////////////////
+
+// Wu's variance-minimizing quantizer, usable as T in doQuant; the histogram is built in parallel
+struct wu_quant {
+    static auto GetPalette(gfx::image const& img, i32 colors, i32 threads = 0) -> std::vector<color>;
+    static auto GetPalette(color_histogram const& hist, i32 colors) -> std::vector<color>;
+};
+
+////////////////////////////////////////////////////////////
+
+// stratified subset of img for palette training, nullopt if rate and maxSamples keep every pixel
+auto make_training_image(gfx::image const& img, f64 rate, i64 maxSamples) -> std::optional<gfx::image>;
+// histogram colors repeated by their weight, at most rate * pixels and maxSamples in total;
+// colors keep at least one sample unless there are more colors than that
+auto make_training_image(color_histogram const& hist, f64 rate, i64 maxSamples) -> gfx::image;
+
+////////////////////////////////////////////////////////////
+
+// palette image with one index byte per pixel; palette entries with A == 0 are transparent
+struct indexed_image {
+    size_i             Size;
+    std::vector<u8>    Indices;
+    std::vector<color> Palette;
+
+    auto color_count() const -> isize;
+};
+
+// dithers img straight to indices; pixels with alpha below 128 get an extra transparent entry,
+// nullopt if the palette has more than 256 colors including that entry
+auto make_indexed(gfx::image const& img, palette_matcher const& matcher, string const& dithering, i32 threads) -> std::optional<indexed_image>;
+// sets the indices of pixels below half alpha, false if img has none
+auto mark_transparent(gfx::image const& img, std::span<u8> indices, u8 transparent) -> bool;
+// true if img has pixels below half alpha; trained palettes leave a slot free for them
+auto has_transparency(gfx::image const& img) -> bool;
+
+// .png (PLTE), .bmp, .pcx and .gif are written by the tool itself, with packed indices;
+// rows can be handed over a band at a time, so the whole image never has to be in memory
+class indexed_writer {
+public:
+    virtual ~indexed_writer() = default;
+
+    // nullptr for other extensions, more than 256 colors or if the file can't be created
+    static auto Create(string const& file, size_i size, std::span<color const> palette) -> std::unique_ptr<indexed_writer>;
+
+    virtual void write_rows(std::span<u8 const> indices) = 0; // whole rows, top to bottom
+    virtual auto finish() -> bool = 0;
+    virtual auto bit_depth() const -> i32 = 0; // bits per index in the file, not always the smallest that fits
+};
+
+auto is_indexed_format(string const& file) -> bool;
+// bits per index written, nullopt on failure
+auto save_indexed(indexed_image const& img, string const& file) -> std::optional<i32>;
+
+// one frame of an animation: the changed part of the canvas, drawn over the previous frame
+struct animation_frame {
+    rect_i             Bounds;
+    std::vector<u8>    Indices;          // Bounds.Width * Bounds.Height, top to bottom
+    std::vector<color> Palette {};       // local color table, empty for the global one
+    i32                Delay {10};       // in 1/100 s
+    i32                Transparent {-1}; // index of pixels that keep the previous frame, -1 for none
+    bool               Dispose {false};  // clears Bounds to transparent once the frame was shown
+};
+
+// animated GIF89a that loops forever; all color tables get the size of the largest palette
+auto save_animation(string const& file, size_i size, std::span<color const> palette, std::span<animation_frame const> frames) -> bool;
+
+////////////////////////////////////////////////////////////
+
+// RGB error between two images of the same size, alpha is ignored;
+// pixels mapped to a transparent palette entry are left out
+auto mean_squared_error(gfx::image const& a, gfx::image const& b) -> f64;
+auto mean_squared_error(gfx::image const& a, indexed_image const& b) -> f64;
+auto psnr(f64 mse) -> f64;
+// mean structural similarity of the luma over 8x8 windows, 1 for identical images
+auto ssim(gfx::image const& a, gfx::image const& b) -> f64;
+// mean CIE76 color difference, euclidean distance in CIELAB; about 2.3 is just noticeable
+auto mean_delta_e(gfx::image const& a, gfx::image const& b) -> f64;
+auto mean_delta_e(gfx::image const& a, indexed_image const& b) -> f64;
+
+////////////////////////////////////////////////////////////
+
+// palettes are stored as GIMP .gpl files
+auto write_palette(string const& file, std::span<color const> palette) -> bool;
+auto read_palette(string const& file) -> std::optional<std::vector<color>>;
+
+////////////////////////////////////////////////////////////
+
+// trains the named quantizer on a histogram; neuquant and octree get a weighted sample image
+auto train_palette(string const& quantizer, color_histogram const& hist, options const& opts) -> std::vector<color>;
+
+struct refine_result {
+    std::vector<color> Palette;
+    std::vector<f64>   Mse; // per channel in the color space coordinates; of the input palette, then after every iteration
+};
+
+// k-means (Lloyd) iterations on the histogram colors, starting from a trained palette; colors are
+// assigned by distance in the given color space and stops early once the palette no longer changes
+auto refine_palette(std::span<color const> palette, color_histogram const& hist, color_space space, i32 iterations, i32 threads) -> refine_result;
+// runs opts.Refine iterations and prints the MSE after each
+auto refine_palette(std::span<color const> palette, color_histogram const& hist, options const& opts) -> std::vector<color>;
+
+// quantizes every image of inFolder to one palette trained on their merged histogram;
+// images are dithered in parallel and the palette is written to outFolder/palette.gpl
+auto quantize_batch(options const& opts, string const& quantizer, string const& inFolder, string const& outFolder) -> i32;
+
+////////////////////////////////////////////////////////////
+
+// reads binary PPM/PAM and uncompressed 24/32 bit BMP files a band of rows at a time
+class scanline_reader {
+public:
+    explicit scanline_reader(string const& file);
+
+    auto is_open() const -> bool;
+    auto size() const -> size_i;
+    auto format() const -> gfx::image::format;
+    auto row() const -> i32; // next row to read
+
+    // up to rows rows from the top down, nullopt at the end or on read errors
+    auto read(i32 rows) -> std::optional<gfx::image>;
+    void rewind();
+
+private:
+    auto open_pnm(char type) -> bool;
+    auto open_bmp() -> bool;
+
+    std::ifstream  _in;
+    size_i         _size;
+    i32            _channels {3};
+    bool           _hasAlpha {false};
+    bool           _bgr {false};
+    bool           _bottomUp {false};
+    std::streamoff _dataOffset {0};
+    isize          _stride {0};
+    i32            _row {0};
+};
+
+// two passes over the input in bands of opts.TileRows rows: palette training on a sample, then
+// dithering straight into an indexed writer; memory stays at a few bands plus the histogram
+auto quantize_tiled(options const& opts, string const& quantizer, string const& input, string const& output) -> i32;
+
+////////////////////////////////////////////////////////////
+
+// quantizes the png frames of inFolder, in name order, to an animated gif; frames share one
+// palette, or one per opts.PaletteWindow frames trained with the window before it, and each
+// frame only stores the rectangle that changed since the previous one; alpha is ignored
+auto quantize_animation(options const& opts, string const& quantizer, string const& inFolder, string const& output) -> i32;
+
+////////////////////////////////////////////////////////////
+
+auto inline print_error(string const& err) -> int
+{
+    std::cout << err;
+    return 1;
+}
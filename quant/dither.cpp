@@ -0,0 +1,547 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "../shared/parallel.hpp"
+#include "common.hpp"
+
+#include <atomic>
+
+// These filters replace gfx::*_dither. The diffusion kernels use the same taps, but the ordered
+// thresholds (amplitude, value noise lattice and hash) are defined here, so dithered output
+// differs from the gfx filters.
+
+namespace {
+
+struct diffusion_tap {
+    i32 DX;
+    i32 DY;
+    f32 Weight;
+};
+
+constexpr std::array<diffusion_tap, 4> FLOYD_STEINBERG_TAPS {{
+    {1, 0, 7.0f / 16.0f},
+    {-1, 1, 3.0f / 16.0f},
+    {0, 1, 5.0f / 16.0f},
+    {1, 1, 1.0f / 16.0f},
+}};
+
+constexpr std::array<diffusion_tap, 6> ATKINSON_TAPS {{
+    {1, 0, 1.0f / 8.0f},
+    {2, 0, 1.0f / 8.0f},
+    {-1, 1, 1.0f / 8.0f},
+    {0, 1, 1.0f / 8.0f},
+    {1, 1, 1.0f / 8.0f},
+    {0, 2, 1.0f / 8.0f},
+}};
+
+// threshold amplitude for ordered dithering: roughly the distance between palette colors
+auto get_spread(i32 colors) -> f32
+{
+    return 255.0f / std::cbrt(static_cast<f32>(std::max(2, colors)));
+}
+
+// ordered dithering thresholds in [-0.5, 0.5), recursive construction: M(2n) = [4M, 4M+2; 4M+3, 4M+1]
+template <i32 Size>
+constexpr auto make_bayer() -> std::array<f32, Size * Size>
+{
+    std::array<i32, Size * Size> matrix {};
+    for (i32 n {1}; n < Size; n *= 2) {
+        std::array<i32, Size * Size> next {};
+        for (i32 y {0}; y < n; ++y) {
+            for (i32 x {0}; x < n; ++x) {
+                i32 const m {4 * matrix[(y * n) + x]};
+                next[(y * 2 * n) + x]           = m;
+                next[(y * 2 * n) + x + n]       = m + 2;
+                next[((y + n) * 2 * n) + x]     = m + 3;
+                next[((y + n) * 2 * n) + x + n] = m + 1;
+            }
+        }
+        matrix = next;
+    }
+
+    std::array<f32, Size * Size> retValue {};
+    for (usize i {0}; i < retValue.size(); ++i) {
+        retValue[i] = ((static_cast<f32>(matrix[i]) + 0.5f) / static_cast<f32>(Size * Size)) - 0.5f;
+    }
+    return retValue;
+}
+
+template <i32 Size>
+constexpr std::array<f32, Size * Size> BAYER_THRESHOLDS {make_bayer<Size>()};
+
+// Hands func the fastest search for the matcher's palette, picked once per call. Colormaps may
+// differ from a full search, so matchers that have one are used as they are. Padding larger
+// palettes to 256 entries loses to the runtime search and the k-d tree, see quant_bench.
+template <typename Func>
+void with_search(palette_matcher const& matcher, Func&& func)
+{
+    i32 const size {matcher.size()};
+    if (matcher.has_colormap() || size < 1) {
+        func(matcher);
+    } else if (size <= 2) {
+        func(fixed_palette_matcher<2> {matcher});
+    } else if (size <= 4) {
+        func(fixed_palette_matcher<4> {matcher});
+    } else if (size <= 16) {
+        func(fixed_palette_matcher<16> {matcher});
+    } else {
+        func(matcher);
+    }
+}
+
+// kernels report one palette index per pixel, sinks decide what to store
+
+// palette colors in the source format, alpha is passed through
+class image_sink {
+public:
+    image_sink(gfx::image const& src, palette_matcher const& matcher)
+        : _src {src.data()}
+        , _colors {matcher.colors()}
+        , _bpp {src.info().bytes_per_pixel()}
+        , _image {gfx::image::CreateEmpty(src.info().Size, src.info().Format)}
+    {
+    }
+
+    void operator()(isize pixel, i32 index)
+    {
+        isize const offset {pixel * _bpp};
+        color const c {_colors[index]};
+        u8*         dst {_image.data().data() + offset};
+        dst[0] = c.R;
+        dst[1] = c.G;
+        dst[2] = c.B;
+        if (_bpp == 4) { dst[3] = _src[offset + 3]; }
+    }
+
+    auto take() -> gfx::image { return std::move(_image); }
+
+private:
+    std::span<u8 const>    _src;
+    std::span<color const> _colors;
+    i32                    _bpp;
+    gfx::image             _image;
+};
+
+// one byte per pixel, the palette must not exceed 256 colors
+class index_sink {
+public:
+    explicit index_sink(gfx::image const& src)
+        : _indices(static_cast<usize>(src.info().Size.Width) * static_cast<usize>(src.info().Size.Height))
+    {
+    }
+
+    void operator()(isize pixel, i32 index)
+    {
+        _indices[static_cast<usize>(pixel)] = static_cast<u8>(index);
+    }
+
+    auto take() -> std::vector<u8> { return std::move(_indices); }
+
+private:
+    std::vector<u8> _indices;
+};
+
+// threshold(x, y) returns an offset in [-0.5, 0.5); pixels are independent, so row bands
+// can run on any number of threads with identical results
+template <typename Sink, typename Search, typename Threshold>
+void ordered(gfx::image const& img, Search const& matcher, i32 threads, Sink& sink, Threshold&& threshold)
+{
+    auto const& info {img.info()};
+    i32 const   bpp {info.bytes_per_pixel()};
+    f32 const   spread {get_spread(matcher.size())};
+    auto const  src {img.data()};
+
+    parallel_for(info.Size.Height, threads, [&](isize begin, isize end) {
+        for (i32 y {static_cast<i32>(begin)}; y < end; ++y) {
+            for (i32 x {0}; x < info.Size.Width; ++x) {
+                isize const pixel {(static_cast<isize>(y) * info.Size.Width) + x};
+                u8 const*   p {src.data() + (pixel * bpp)};
+                f32 const   t {threshold(x, y) * spread};
+                i32 const   r {std::clamp(static_cast<i32>(std::lround(p[0] + t)), 0, 255)};
+                i32 const   g {std::clamp(static_cast<i32>(std::lround(p[1] + t)), 0, 255)};
+                i32 const   b {std::clamp(static_cast<i32>(std::lround(p[2] + t)), 0, 255)};
+                sink(pixel, matcher.nearest(r, g, b));
+            }
+        }
+    });
+}
+
+// Rows run as a wavefront: worker t handles rows t, t + threads, ..., and each row stays a fixed
+// number of pixels behind the row above. The lag is chosen so that every error cell receives its
+// additions in the same order as in a serial scan, which keeps the output bit-identical.
+// carry holds the error rows below the previous band on entry and below this one on return.
+template <typename Sink, typename Search, usize N>
+void diffuse(gfx::image const& img, Search const& matcher, std::array<diffusion_tap, N> const& taps, i32 threads, Sink& sink, std::vector<f32>& carry)
+{
+    auto const& info {img.info()};
+    i32 const   width {info.Size.Width};
+    i32 const   height {info.Size.Height};
+    i32 const   bpp {info.bytes_per_pixel()};
+    auto const  colors {matcher.colors()};
+
+    i32 maxDX {0};
+    i32 maxDY {0};
+    i32 minDXBelow {0}; // leftmost tap into the next row
+    i32 maxDXRight {0}; // rightmost tap into the same row
+    for (auto const& tap : taps) {
+        maxDX = std::max(maxDX, std::abs(tap.DX));
+        maxDY = std::max(maxDY, tap.DY);
+        if (tap.DY == 1) { minDXBelow = std::min(minDXBelow, tap.DX); }
+        if (tap.DY == 0) { maxDXRight = std::max(maxDXRight, tap.DX); }
+    }
+
+    // A row may read cell x once the row above has passed x - minDXBelow, and may add to cell
+    // x + maxDXRight only after the row above is done with it.
+    i32 const lag {1 - minDXBelow + maxDXRight};
+
+    if (threads <= 0) { threads = static_cast<i32>(std::max(1u, std::thread::hardware_concurrency())); }
+    threads = std::clamp(threads, 1, std::max(1, height));
+
+    // ring of error rows, padded so taps never leave the buffer; rows in flight plus their taps
+    i32 const        rows {threads + maxDY + 1};
+    isize const      rowSize {static_cast<isize>(width + (2 * maxDX)) * 3};
+    std::vector<f32> error(static_cast<usize>(rowSize * rows), 0.0f);
+    auto const       errorAt {[&](i32 x, i32 y) { return error.data() + ((y % rows) * rowSize) + ((x + maxDX) * 3); }};
+
+    if (std::ssize(carry) == rowSize * maxDY) {
+        for (i32 y {0}; y < maxDY; ++y) { std::copy_n(carry.data() + (y * rowSize), rowSize, errorAt(-maxDX, y)); }
+    }
+
+    // finished pixels per row, published every PROGRESS_STEP pixels
+    constexpr i32                 PROGRESS_STEP {32};
+    std::vector<std::atomic<i32>> progress(static_cast<usize>(height));
+
+    auto const src {img.data()};
+
+    auto const processRow {[&](i32 y) {
+        std::atomic<i32> const* above {y > 0 ? &progress[y - 1] : nullptr};
+        i32                     ready {above ? above->load(std::memory_order_acquire) : width};
+
+        for (i32 x {0}; x < width; ++x) {
+            i32 const needed {std::min(width, x + lag)};
+            while (ready < needed) {
+                std::this_thread::yield();
+                ready = above->load(std::memory_order_acquire);
+            }
+
+            isize const pixel {(static_cast<isize>(y) * width) + x};
+            u8 const*   p {src.data() + (pixel * bpp)};
+            f32 const*  err {errorAt(x, y)};
+
+            std::array<f32, 3> const value {
+                std::clamp(p[0] + err[0], 0.0f, 255.0f),
+                std::clamp(p[1] + err[1], 0.0f, 255.0f),
+                std::clamp(p[2] + err[2], 0.0f, 255.0f)};
+            i32 const   idx {matcher.nearest(static_cast<i32>(std::lround(value[0])), static_cast<i32>(std::lround(value[1])), static_cast<i32>(std::lround(value[2])))};
+            color const c {colors[idx]};
+            sink(pixel, idx);
+
+            std::array<f32, 3> const diff {value[0] - c.R, value[1] - c.G, value[2] - c.B};
+            for (auto const& tap : taps) {
+                f32* e {errorAt(x + tap.DX, y + tap.DY)};
+                e[0] += diff[0] * tap.Weight;
+                e[1] += diff[1] * tap.Weight;
+                e[2] += diff[2] * tap.Weight;
+            }
+
+            if ((x + 1) % PROGRESS_STEP == 0) { progress[y].store(x + 1, std::memory_order_release); }
+        }
+
+        // the row is reused for y + rows, clear it before the row below may finish
+        std::fill_n(errorAt(-maxDX, y), rowSize, 0.0f);
+        progress[y].store(width, std::memory_order_release);
+    }};
+
+    auto const worker {[&](i32 first) {
+        for (i32 y {first}; y < height; y += threads) { processRow(y); }
+    }};
+
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(static_cast<usize>(threads - 1));
+        for (i32 t {1}; t < threads; ++t) { workers.emplace_back(worker, t); }
+        worker(0);
+    }
+
+    carry.resize(static_cast<usize>(rowSize * maxDY));
+    for (i32 y {0}; y < maxDY; ++y) { std::copy_n(errorAt(-maxDX, height + y), rowSize, carry.data() + (y * rowSize)); }
+}
+
+auto hash_noise(i32 x, i32 y) -> f32
+{
+    u32 h {(static_cast<u32>(x) * 374761393u) + (static_cast<u32>(y) * 668265263u)};
+    h = (h ^ (h >> 13)) * 1274126177u;
+    h ^= h >> 16;
+    return static_cast<f32>(h & 0xFFFFFF) / 16777216.0f;
+}
+
+template <i32 Size, typename Sink, typename Search>
+void bayer(gfx::image const& img, Search const& matcher, i32 threads, i32 top, Sink& sink)
+{
+    ordered(img, matcher, threads, sink, [&](i32 x, i32 y) {
+        return BAYER_THRESHOLDS<Size>[(((y + top) & (Size - 1)) * Size) + (x & (Size - 1))];
+    });
+}
+
+}
+
+////////////////////////////////////////////////////////////
+
+nearest_dither::nearest_dither(palette_matcher const& matcher, i32 threads)
+    : _matcher {matcher}
+    , _threads {threads}
+{
+}
+
+auto nearest_dither::operator()(gfx::image const& img) const -> gfx::image
+{
+    image_sink  sink {img, _matcher};
+    dither_band band {.ImageSize = img.info().Size};
+    run(img, sink, band);
+    return sink.take();
+}
+
+auto nearest_dither::indices(gfx::image const& img) const -> std::vector<u8>
+{
+    dither_band band {.ImageSize = img.info().Size};
+    return indices(img, band);
+}
+
+auto nearest_dither::indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>
+{
+    index_sink sink {img};
+    run(img, sink, band);
+    band.Top += img.info().Size.Height;
+    return sink.take();
+}
+
+template <typename Sink>
+void nearest_dither::run(gfx::image const& img, Sink& sink, dither_band&) const
+{
+    with_search(_matcher, [&](auto const& matcher) { ordered(img, matcher, _threads, sink, [](i32, i32) { return 0.0f; }); });
+}
+
+////////////////////////////////////////////////////////////
+
+bayer_dither::bayer_dither(palette_matcher const& matcher, gfx::bayer_matrix matrix, i32 threads)
+    : _matcher {matcher}
+    , _size {matrix == gfx::bayer_matrix::Bayer2x2 ? 2 : matrix == gfx::bayer_matrix::Bayer4x4 ? 4 : 8}
+    , _threads {threads}
+{
+}
+
+auto bayer_dither::operator()(gfx::image const& img) const -> gfx::image
+{
+    image_sink  sink {img, _matcher};
+    dither_band band {.ImageSize = img.info().Size};
+    run(img, sink, band);
+    return sink.take();
+}
+
+auto bayer_dither::indices(gfx::image const& img) const -> std::vector<u8>
+{
+    dither_band band {.ImageSize = img.info().Size};
+    return indices(img, band);
+}
+
+auto bayer_dither::indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>
+{
+    index_sink sink {img};
+    run(img, sink, band);
+    band.Top += img.info().Size.Height;
+    return sink.take();
+}
+
+template <typename Sink>
+void bayer_dither::run(gfx::image const& img, Sink& sink, dither_band& band) const
+{
+    with_search(_matcher, [&](auto const& matcher) {
+        switch (_size) {
+        case 2: bayer<2>(img, matcher, _threads, band.Top, sink); break;
+        case 4: bayer<4>(img, matcher, _threads, band.Top, sink); break;
+        default: bayer<8>(img, matcher, _threads, band.Top, sink); break;
+        }
+    });
+}
+
+////////////////////////////////////////////////////////////
+
+value_noise_dither::value_noise_dither(palette_matcher const& matcher, size_i noiseSize, i32 threads)
+    : _matcher {matcher}
+    , _noiseSize {std::max(1, noiseSize.Width), std::max(1, noiseSize.Height)}
+    , _threads {threads}
+{
+}
+
+auto value_noise_dither::operator()(gfx::image const& img) const -> gfx::image
+{
+    image_sink  sink {img, _matcher};
+    dither_band band {.ImageSize = img.info().Size};
+    run(img, sink, band);
+    return sink.take();
+}
+
+auto value_noise_dither::indices(gfx::image const& img) const -> std::vector<u8>
+{
+    dither_band band {.ImageSize = img.info().Size};
+    return indices(img, band);
+}
+
+auto value_noise_dither::indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>
+{
+    index_sink sink {img};
+    run(img, sink, band);
+    band.Top += img.info().Size.Height;
+    return sink.take();
+}
+
+template <typename Sink>
+void value_noise_dither::run(gfx::image const& img, Sink& sink, dither_band& band) const
+{
+    // one lattice point per cell, smoothly interpolated in between
+    auto const size {band.ImageSize};
+    i32 const  top {band.Top};
+    f32 const  scaleX {static_cast<f32>(_noiseSize.Width) / static_cast<f32>(size.Width)};
+    f32 const  scaleY {static_cast<f32>(_noiseSize.Height) / static_cast<f32>(size.Height)};
+    auto const threshold {[&](i32 x, i32 y) {
+        f32 const fx {(static_cast<f32>(x) + 0.5f) * scaleX};
+        f32 const fy {(static_cast<f32>(y + top) + 0.5f) * scaleY};
+        i32 const ix {static_cast<i32>(fx)};
+        i32 const iy {static_cast<i32>(fy)};
+        f32       tx {fx - static_cast<f32>(ix)};
+        f32       ty {fy - static_cast<f32>(iy)};
+        tx = tx * tx * (3.0f - (2.0f * tx));
+        ty = ty * ty * (3.0f - (2.0f * ty));
+
+        f32 const n0 {std::lerp(hash_noise(ix, iy), hash_noise(ix + 1, iy), tx)};
+        f32 const n1 {std::lerp(hash_noise(ix, iy + 1), hash_noise(ix + 1, iy + 1), tx)};
+        return std::lerp(n0, n1, ty) - 0.5f;
+    }};
+    with_search(_matcher, [&](auto const& matcher) { ordered(img, matcher, _threads, sink, threshold); });
+}
+
+////////////////////////////////////////////////////////////
+
+floyd_steinberg_dither::floyd_steinberg_dither(palette_matcher const& matcher, i32 threads)
+    : _matcher {matcher}
+    , _threads {threads}
+{
+}
+
+auto floyd_steinberg_dither::operator()(gfx::image const& img) const -> gfx::image
+{
+    image_sink  sink {img, _matcher};
+    dither_band band {.ImageSize = img.info().Size};
+    run(img, sink, band);
+    return sink.take();
+}
+
+auto floyd_steinberg_dither::indices(gfx::image const& img) const -> std::vector<u8>
+{
+    dither_band band {.ImageSize = img.info().Size};
+    return indices(img, band);
+}
+
+auto floyd_steinberg_dither::indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>
+{
+    index_sink sink {img};
+    run(img, sink, band);
+    band.Top += img.info().Size.Height;
+    return sink.take();
+}
+
+template <typename Sink>
+void floyd_steinberg_dither::run(gfx::image const& img, Sink& sink, dither_band& band) const
+{
+    with_search(_matcher, [&](auto const& matcher) { diffuse(img, matcher, FLOYD_STEINBERG_TAPS, _threads, sink, band.Carry); });
+}
+
+////////////////////////////////////////////////////////////
+
+atkinson_dither::atkinson_dither(palette_matcher const& matcher, i32 threads)
+    : _matcher {matcher}
+    , _threads {threads}
+{
+}
+
+auto atkinson_dither::operator()(gfx::image const& img) const -> gfx::image
+{
+    image_sink  sink {img, _matcher};
+    dither_band band {.ImageSize = img.info().Size};
+    run(img, sink, band);
+    return sink.take();
+}
+
+auto atkinson_dither::indices(gfx::image const& img) const -> std::vector<u8>
+{
+    dither_band band {.ImageSize = img.info().Size};
+    return indices(img, band);
+}
+
+auto atkinson_dither::indices(gfx::image const& img, dither_band& band) const -> std::vector<u8>
+{
+    index_sink sink {img};
+    run(img, sink, band);
+    band.Top += img.info().Size.Height;
+    return sink.take();
+}
+
+template <typename Sink>
+void atkinson_dither::run(gfx::image const& img, Sink& sink, dither_band& band) const
+{
+    with_search(_matcher, [&](auto const& matcher) { diffuse(img, matcher, ATKINSON_TAPS, _threads, sink, band.Carry); });
+}
+
+////////////////////////////////////////////////////////////
+
+namespace {
+
+// constructs the filter named on the command line and hands it to func
+template <typename Func>
+auto with_dither(size_i imageSize, palette_matcher const& matcher, string const& dithering, i32 threads, Func&& func)
+{
+    if (dithering == "bayer2") {
+        return func(bayer_dither {matcher, gfx::bayer_matrix::Bayer2x2, threads});
+    }
+    if (dithering == "bayer4") {
+        return func(bayer_dither {matcher, gfx::bayer_matrix::Bayer4x4, threads});
+    }
+    if (dithering == "bayer8") {
+        return func(bayer_dither {matcher, gfx::bayer_matrix::Bayer8x8, threads});
+    }
+    if (dithering == "atkinson") {
+        return func(atkinson_dither {matcher, threads});
+    }
+    if (dithering == "floyd-steinberg") {
+        return func(floyd_steinberg_dither {matcher, threads});
+    }
+    if (dithering == "noise1") {
+        return func(value_noise_dither {matcher, imageSize, threads});
+    }
+    if (dithering == "noise8") {
+        return func(value_noise_dither {matcher, imageSize / 8, threads});
+    }
+    if (dithering == "noise32") {
+        return func(value_noise_dither {matcher, imageSize / 32, threads});
+    }
+    return func(nearest_dither {matcher, threads});
+}
+
+}
+
+auto dither_image(gfx::image const& img, palette_matcher const& matcher, string const& dithering, i32 threads) -> gfx::image
+{
+    return with_dither(img.info().Size, matcher, dithering, threads, [&](auto const& filter) { return filter(img); });
+}
+
+auto dither_indices(gfx::image const& img, palette_matcher const& matcher, string const& dithering, i32 threads) -> std::vector<u8>
+{
+    return with_dither(img.info().Size, matcher, dithering, threads, [&](auto const& filter) { return filter.indices(img); });
+}
+
+auto dither_indices(gfx::image const& img, palette_matcher const& matcher, string const& dithering, dither_band& band, i32 threads) -> std::vector<u8>
+{
+    return with_dither(band.ImageSize, matcher, dithering, threads, [&](auto const& filter) { return filter.indices(img, band); });
+}
@@ -0,0 +1,159 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "../shared/parallel.hpp"
+#include "common.hpp"
+
+#include <mutex>
+
+namespace {
+
+using entry = color_histogram::entry;
+
+// LSD radix sort on bytes, passes where every value shares the digit (e.g. opaque alpha) are skipped
+void radix_sort(std::vector<u32>& values, std::vector<u32>& scratch)
+{
+    scratch.resize(values.size());
+    for (u32 shift {0}; shift < 32; shift += 8) {
+        std::array<usize, 256> offsets {};
+        for (u32 const v : values) { ++offsets[(v >> shift) & 0xFF]; }
+        if (offsets[(values.front() >> shift) & 0xFF] == values.size()) { continue; }
+
+        usize sum {0};
+        for (auto& o : offsets) {
+            usize const count {o};
+            o = sum;
+            sum += count;
+        }
+        for (u32 const v : values) { scratch[offsets[(v >> shift) & 0xFF]++] = v; }
+        values.swap(scratch);
+    }
+}
+
+auto merge(std::vector<entry> const& a, std::vector<entry> const& b) -> std::vector<entry>
+{
+    std::vector<entry> retValue;
+    retValue.reserve(a.size() + b.size());
+
+    usize i {0};
+    usize j {0};
+    while (i < a.size() && j < b.size()) {
+        if (a[i].Color < b[j].Color) {
+            retValue.push_back(a[i++]);
+        } else if (b[j].Color < a[i].Color) {
+            retValue.push_back(b[j++]);
+        } else {
+            retValue.push_back({a[i].Color, a[i].Count + b[j].Count});
+            ++i;
+            ++j;
+        }
+    }
+    retValue.insert(retValue.end(), a.begin() + static_cast<isize>(i), a.end());
+    retValue.insert(retValue.end(), b.begin() + static_cast<isize>(j), b.end());
+    return retValue;
+}
+
+// pairwise merge of sorted parts, the result does not depend on their order
+auto merge_all(std::vector<std::vector<entry>> parts) -> std::vector<entry>
+{
+    while (parts.size() > 1) {
+        std::vector<std::vector<entry>> next;
+        for (usize i {0}; i + 1 < parts.size(); i += 2) { next.push_back(merge(parts[i], parts[i + 1])); }
+        if (parts.size() % 2 == 1) { next.push_back(std::move(parts.back())); }
+        parts = std::move(next);
+    }
+    return parts.empty() ? std::vector<entry> {} : std::move(parts.front());
+}
+
+}
+
+auto color_histogram::entry::get_color() const -> color
+{
+    return color {static_cast<u8>(Color >> 24), static_cast<u8>(Color >> 16), static_cast<u8>(Color >> 8), static_cast<u8>(Color)};
+}
+
+auto color_histogram::Build(gfx::image const& img, i32 threads) -> color_histogram
+{
+    auto const& info {img.info()};
+    i32 const   width {info.Size.Width};
+    bool const  hasAlpha {info.bytes_per_pixel() == 4};
+    auto const  data {img.data()};
+
+    // every band packs its pixels to RGBA words, sorts them and counts the runs
+    std::vector<std::vector<entry>> parts;
+    std::mutex                      mutex;
+    parallel_for(info.Size.Height, threads, [&](isize begin, isize end) {
+        std::vector<u32> values(static_cast<usize>((end - begin) * width));
+        std::vector<u32> scratch;
+
+        u8 const* p {data.data() + (begin * info.stride())};
+        if (hasAlpha) {
+            for (u32& v : values) {
+                v = (static_cast<u32>(p[0]) << 24) | (static_cast<u32>(p[1]) << 16) | (static_cast<u32>(p[2]) << 8) | p[3];
+                p += 4;
+            }
+        } else {
+            for (u32& v : values) {
+                v = (static_cast<u32>(p[0]) << 24) | (static_cast<u32>(p[1]) << 16) | (static_cast<u32>(p[2]) << 8) | 0xFF;
+                p += 3;
+            }
+        }
+        if (values.empty()) { return; }
+        radix_sort(values, scratch);
+
+        std::vector<entry> local;
+        for (u32 const v : values) {
+            if (!local.empty() && local.back().Color == v) {
+                ++local.back().Count;
+            } else {
+                local.push_back({v, 1});
+            }
+        }
+
+        std::scoped_lock lock {mutex};
+        parts.push_back(std::move(local));
+    });
+
+    color_histogram retValue;
+    retValue._entries    = merge_all(std::move(parts));
+    retValue._pixelCount = static_cast<i64>(width) * info.Size.Height;
+    return retValue;
+}
+
+auto color_histogram::Merge(std::span<color_histogram const> histograms) -> color_histogram
+{
+    std::vector<std::vector<entry>> parts;
+    color_histogram                 retValue;
+    for (auto const& hist : histograms) {
+        parts.push_back(hist._entries);
+        retValue._pixelCount += hist._pixelCount;
+    }
+    retValue._entries = merge_all(std::move(parts));
+    return retValue;
+}
+
+auto color_histogram::entries() const -> std::span<entry const>
+{
+    return _entries;
+}
+
+auto color_histogram::color_count() const -> isize
+{
+    return std::ssize(_entries);
+}
+
+auto color_histogram::pixel_count() const -> i64
+{
+    return _pixelCount;
+}
+
+void color_histogram::remove_transparent()
+{
+    std::erase_if(_entries, [&](entry const& e) {
+        if ((e.Color & 0xFF) >= 128) { return false; }
+        _pixelCount -= e.Count;
+        return true;
+    });
+}
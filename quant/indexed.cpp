@@ -0,0 +1,774 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+#include <fstream>
+
+namespace {
+
+void put_le16(std::vector<u8>& out, u32 value)
+{
+    out.push_back(static_cast<u8>(value));
+    out.push_back(static_cast<u8>(value >> 8));
+}
+
+void put_le32(std::vector<u8>& out, u32 value)
+{
+    put_le16(out, value);
+    put_le16(out, value >> 16);
+}
+
+void put_be32(std::vector<u8>& out, u32 value)
+{
+    out.push_back(static_cast<u8>(value >> 24));
+    out.push_back(static_cast<u8>(value >> 16));
+    out.push_back(static_cast<u8>(value >> 8));
+    out.push_back(static_cast<u8>(value));
+}
+
+// 1, 2, 4 or 8 bits, the smallest that holds every index
+auto get_bit_depth(usize colors) -> i32
+{
+    return colors <= 2 ? 1 : colors <= 4 ? 2 : colors <= 16 ? 4 : 8;
+}
+
+// packs one row of indices, leftmost pixel in the high bits
+void pack_row(std::span<u8 const> row, i32 bits, u8* dst)
+{
+    if (bits == 8) {
+        std::copy(row.begin(), row.end(), dst);
+        return;
+    }
+
+    i32 const perByte {8 / bits};
+    for (usize x {0}; x < row.size(); ++x) {
+        i32 const shift {8 - (bits * static_cast<i32>((x % perByte) + 1))};
+        dst[x / perByte] |= static_cast<u8>(row[x] << shift);
+    }
+}
+
+// LSB-first bit stream, shared by deflate and GIF LZW
+class bit_writer {
+public:
+    explicit bit_writer(std::vector<u8>& out)
+        : _out {out}
+    {
+    }
+
+    void put(u32 value, i32 bits)
+    {
+        _buffer |= static_cast<u64>(value) << _count;
+        _count += bits;
+        while (_count >= 8) {
+            _out.push_back(static_cast<u8>(_buffer));
+            _buffer >>= 8;
+            _count -= 8;
+        }
+    }
+
+    // Huffman codes are stored starting with their most significant bit
+    void put_code(u32 code, i32 bits)
+    {
+        u32 reversed {0};
+        for (i32 i {0}; i < bits; ++i) { reversed = (reversed << 1) | ((code >> i) & 1); }
+        put(reversed, bits);
+    }
+
+    void flush()
+    {
+        if (_count > 0) { _out.push_back(static_cast<u8>(_buffer)); }
+        _buffer = 0;
+        _count  = 0;
+    }
+
+private:
+    std::vector<u8>& _out;
+    u64              _buffer {0};
+    i32              _count {0};
+};
+
+////////////////////////////////////////////////////////////
+
+constexpr std::array<u16, 29> LENGTH_BASE {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<u8, 29>  LENGTH_EXTRA {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<u16, 30> DIST_BASE {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::array<u8, 30>  DIST_EXTRA {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// literal/length symbol with the fixed Huffman code of RFC 1951, 3.2.6
+void put_symbol(bit_writer& bits, i32 symbol)
+{
+    if (symbol < 144) {
+        bits.put_code(static_cast<u32>(0x30 + symbol), 8);
+    } else if (symbol < 256) {
+        bits.put_code(static_cast<u32>(0x190 + symbol - 144), 9);
+    } else if (symbol < 280) {
+        bits.put_code(static_cast<u32>(symbol - 256), 7);
+    } else {
+        bits.put_code(static_cast<u32>(0xC0 + symbol - 280), 8);
+    }
+}
+
+void put_match(bit_writer& bits, i32 length, i32 distance)
+{
+    auto const lengthCode {static_cast<usize>(std::upper_bound(LENGTH_BASE.begin(), LENGTH_BASE.end(), length) - LENGTH_BASE.begin() - 1)};
+    put_symbol(bits, 257 + static_cast<i32>(lengthCode));
+    bits.put(static_cast<u32>(length - LENGTH_BASE[lengthCode]), LENGTH_EXTRA[lengthCode]);
+
+    auto const distCode {static_cast<usize>(std::upper_bound(DIST_BASE.begin(), DIST_BASE.end(), distance) - DIST_BASE.begin() - 1)};
+    bits.put_code(static_cast<u32>(distCode), 5);
+    bits.put(static_cast<u32>(distance - DIST_BASE[distCode]), DIST_EXTRA[distCode]);
+}
+
+// zlib stream of fixed-Huffman deflate blocks, one per write; greedy LZ77 over hash chains that
+// may reach back into earlier writes. Index data is repetitive enough that dynamic tables would
+// gain little.
+class zlib_stream {
+public:
+    zlib_stream()
+        : _bits {_out}
+    {
+        _out = {0x78, 0x01};
+    }
+
+    zlib_stream(zlib_stream const&)                    = delete;
+    auto operator=(zlib_stream const&) -> zlib_stream& = delete;
+
+    void write(std::span<u8 const> data, bool final)
+    {
+        constexpr isize WINDOW {32768};
+        constexpr i32   HASH_BITS {15};
+        constexpr i32   MAX_CHAIN {32};
+        constexpr i32   MIN_MATCH {3};
+        constexpr i32   MAX_MATCH {258};
+
+        _bits.put(final ? 1 : 0, 1);
+        _bits.put(1, 2); // fixed Huffman codes
+
+        // the tail of the previous write stays addressable by matches
+        isize const start {std::ssize(_history)};
+        _history.insert(_history.end(), data.begin(), data.end());
+        std::span<u8 const> const buffer {_history};
+        isize const               size {std::ssize(buffer)};
+
+        std::vector<isize> head(usize {1} << HASH_BITS, -1);
+        std::vector<isize> prev(static_cast<usize>(WINDOW), -1);
+
+        auto const hash {[&](isize i) {
+            u32 const h {(static_cast<u32>(buffer[i]) << 16) | (static_cast<u32>(buffer[i + 1]) << 8) | buffer[i + 2]};
+            return (h * 2654435761u) >> (32 - HASH_BITS);
+        }};
+        auto const insert {[&](isize i) {
+            if (i + MIN_MATCH > size) { return; }
+            u32 const h {hash(i)};
+            prev[i & (WINDOW - 1)] = head[h];
+            head[h]                = i;
+        }};
+        for (isize i {0}; i < start; ++i) { insert(i); }
+
+        isize pos {start};
+        while (pos < size) {
+            i32   bestLength {0};
+            isize bestDistance {0};
+            if (pos + MIN_MATCH <= size) {
+                i32 const maxLength {static_cast<i32>(std::min<isize>(MAX_MATCH, size - pos))};
+                isize     candidate {head[hash(pos)]};
+                for (i32 chain {0}; chain < MAX_CHAIN && candidate >= 0 && pos - candidate <= WINDOW; ++chain) {
+                    if (buffer[candidate + bestLength] == buffer[pos + bestLength]) {
+                        i32 length {0};
+                        while (length < maxLength && buffer[candidate + length] == buffer[pos + length]) { ++length; }
+                        if (length > bestLength) {
+                            bestLength   = length;
+                            bestDistance = pos - candidate;
+                            if (length == maxLength) { break; }
+                        }
+                    }
+                    isize const next {prev[candidate & (WINDOW - 1)]};
+                    if (next >= candidate) { break; }
+                    candidate = next;
+                }
+            }
+
+            if (bestLength >= MIN_MATCH) {
+                put_match(_bits, bestLength, static_cast<i32>(bestDistance));
+                for (isize i {pos}; i < pos + bestLength; ++i) { insert(i); }
+                pos += bestLength;
+            } else {
+                put_symbol(_bits, buffer[pos]);
+                insert(pos);
+                ++pos;
+            }
+        }
+        put_symbol(_bits, 256);
+
+        if (size > WINDOW) { _history.erase(_history.begin(), _history.end() - WINDOW); }
+
+        for (usize i {0}; i < data.size();) {
+            usize const end {std::min(data.size(), i + 5552)}; // largest run without overflow
+            for (; i < end; ++i) {
+                _adlerA += data[i];
+                _adlerB += _adlerA;
+            }
+            _adlerA %= 65521;
+            _adlerB %= 65521;
+        }
+
+        if (final) {
+            _bits.flush();
+            put_be32(_out, (_adlerB << 16) | _adlerA);
+        }
+    }
+
+    // compressed bytes so far, bits of an unfinished byte stay behind
+    auto take() -> std::vector<u8>
+    {
+        std::vector<u8> retValue;
+        std::swap(retValue, _out);
+        return retValue;
+    }
+
+private:
+    std::vector<u8> _out;
+    bit_writer      _bits;
+    std::vector<u8> _history;
+    u32             _adlerA {1};
+    u32             _adlerB {0};
+};
+
+constexpr auto CRC_TABLE {[] {
+    std::array<u32, 256> retValue {};
+    for (u32 n {0}; n < 256; ++n) {
+        u32 c {n};
+        for (i32 k {0}; k < 8; ++k) { c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1; }
+        retValue[n] = c;
+    }
+    return retValue;
+}()};
+
+////////////////////////////////////////////////////////////
+
+// shared by the formats: output file, palette and a running row count
+class file_writer : public indexed_writer {
+public:
+    file_writer(string const& file, size_i size, std::span<color const> palette, i32 bits)
+        : _out {file, std::ios::binary | std::ios::trunc}
+        , _size {size}
+        , _palette {palette.begin(), palette.end()}
+        , _bits {bits}
+    {
+    }
+
+    auto is_open() const -> bool { return static_cast<bool>(_out); }
+    auto bit_depth() const -> i32 override { return _bits; }
+
+protected:
+    void write(std::span<u8 const> data)
+    {
+        _out.write(reinterpret_cast<char const*>(data.data()), std::ssize(data));
+    }
+
+    auto rows_in(std::span<u8 const> indices) const -> i32
+    {
+        return static_cast<i32>(indices.size() / static_cast<usize>(_size.Width));
+    }
+
+    std::ofstream      _out;
+    size_i             _size;
+    std::vector<color> _palette;
+    i32                _bits;
+    i32                _row {0};
+};
+
+// IDAT chunk per band, filter type 0 on every row as recommended for palette images
+class png_writer : public file_writer {
+public:
+    png_writer(string const& file, size_i size, std::span<color const> palette)
+        : file_writer {file, size, palette, get_bit_depth(palette.size())}
+    {
+        write(std::array<u8, 8> {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'});
+
+        std::vector<u8> header;
+        put_be32(header, static_cast<u32>(_size.Width));
+        put_be32(header, static_cast<u32>(_size.Height));
+        header.insert(header.end(), {static_cast<u8>(_bits), 3, 0, 0, 0}); // depth, palette, deflate, filter, no interlace
+        write_chunk("IHDR", header);
+
+        std::vector<u8> colors;
+        std::vector<u8> alpha;
+        for (color const& c : _palette) {
+            colors.insert(colors.end(), {c.R, c.G, c.B});
+            alpha.push_back(c.A);
+        }
+        write_chunk("PLTE", colors);
+
+        // tRNS may stop after the last non-opaque entry
+        while (!alpha.empty() && alpha.back() == 255) { alpha.pop_back(); }
+        if (!alpha.empty()) { write_chunk("tRNS", alpha); }
+    }
+
+    void write_rows(std::span<u8 const> indices) override
+    {
+        usize const width {static_cast<usize>(_size.Width)};
+        usize const stride {((width * static_cast<usize>(_bits)) + 7) / 8};
+        usize const rows {static_cast<usize>(rows_in(indices))};
+
+        std::vector<u8> raw((stride + 1) * rows, 0);
+        for (usize y {0}; y < rows; ++y) {
+            pack_row(indices.subspan(y * width, width), _bits, raw.data() + (y * (stride + 1)) + 1);
+        }
+        _row += static_cast<i32>(rows);
+
+        _zlib.write(raw, false);
+        auto const data {_zlib.take()};
+        if (!data.empty()) { write_chunk("IDAT", data); }
+    }
+
+    auto finish() -> bool override
+    {
+        _zlib.write({}, true);
+        write_chunk("IDAT", _zlib.take());
+        write_chunk("IEND", {});
+        _out.close();
+        return _row == _size.Height && !_out.fail();
+    }
+
+private:
+    void write_chunk(char const (&type)[5], std::span<u8 const> data)
+    {
+        std::vector<u8> chunk;
+        chunk.reserve(data.size() + 12);
+        put_be32(chunk, static_cast<u32>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+
+        u32 crc {0xFFFFFFFF};
+        for (usize i {4}; i < chunk.size(); ++i) { crc = CRC_TABLE[(crc ^ chunk[i]) & 0xFF] ^ (crc >> 8); }
+        put_be32(chunk, crc ^ 0xFFFFFFFF);
+        write(chunk);
+    }
+
+    zlib_stream _zlib;
+};
+
+// bottom-up BITMAPINFOHEADER file, rows are placed by seeking since their offsets are known
+// upfront; BMP has no 2 bit mode, so those use 4 bits
+class bmp_writer : public file_writer {
+public:
+    bmp_writer(string const& file, size_i size, std::span<color const> palette)
+        : file_writer {file, size, palette, get_bit_depth(palette.size()) == 2 ? 4 : get_bit_depth(palette.size())}
+        , _stride {(((static_cast<usize>(size.Width) * static_cast<usize>(_bits)) + 31) / 32) * 4}
+        , _offset {14 + 40 + (4 * static_cast<u32>(palette.size()))}
+    {
+        u32 const pixelBytes {static_cast<u32>(_stride * static_cast<usize>(size.Height))};
+
+        std::vector<u8> header {'B', 'M'};
+        put_le32(header, _offset + pixelBytes);
+        put_le32(header, 0);
+        put_le32(header, _offset);
+
+        put_le32(header, 40);
+        put_le32(header, static_cast<u32>(size.Width));
+        put_le32(header, static_cast<u32>(size.Height));
+        put_le16(header, 1);
+        put_le16(header, static_cast<u32>(_bits));
+        put_le32(header, 0); // BI_RGB
+        put_le32(header, pixelBytes);
+        put_le32(header, 2835); // 72 dpi
+        put_le32(header, 2835);
+        put_le32(header, static_cast<u32>(palette.size()));
+        put_le32(header, 0);
+
+        for (color const& c : palette) { header.insert(header.end(), {c.B, c.G, c.R, 0}); }
+        write(header);
+    }
+
+    void write_rows(std::span<u8 const> indices) override
+    {
+        usize const     width {static_cast<usize>(_size.Width)};
+        i32 const       rows {rows_in(indices)};
+        std::vector<u8> line(_stride);
+        for (i32 y {0}; y < rows; ++y, ++_row) {
+            std::ranges::fill(line, u8 {0});
+            pack_row(indices.subspan(static_cast<usize>(y) * width, width), _bits, line.data());
+            _out.seekp(static_cast<std::streamoff>(_offset + (static_cast<usize>(_size.Height - 1 - _row) * _stride)));
+            write(line);
+        }
+    }
+
+    auto finish() -> bool override
+    {
+        _out.close();
+        return _row == _size.Height && !_out.fail();
+    }
+
+private:
+    usize _stride;
+    u32   _offset;
+};
+
+// version 5 PCX with one 8 bit plane, RLE rows and the 256 color palette at the end;
+// the planar 1 and 4 bit modes are poorly supported by readers, so depth is always 8
+class pcx_writer : public file_writer {
+public:
+    pcx_writer(string const& file, size_i size, std::span<color const> palette)
+        : file_writer {file, size, palette, 8}
+        , _bytesPerLine {(static_cast<usize>(size.Width) + 1) & ~usize {1}}
+    {
+        std::vector<u8> header {0x0A, 5, 1, 8};
+        put_le16(header, 0);
+        put_le16(header, 0);
+        put_le16(header, static_cast<u32>(size.Width - 1));
+        put_le16(header, static_cast<u32>(size.Height - 1));
+        put_le16(header, 72);
+        put_le16(header, 72);
+        header.resize(65, 0); // 16 color header palette, reserved byte
+        header.push_back(1);  // planes
+        put_le16(header, static_cast<u32>(_bytesPerLine));
+        put_le16(header, 1); // color palette
+        header.resize(128, 0);
+        write(header);
+    }
+
+    void write_rows(std::span<u8 const> indices) override
+    {
+        usize const     width {static_cast<usize>(_size.Width)};
+        i32 const       rows {rows_in(indices)};
+        std::vector<u8> line(_bytesPerLine, 0);
+        std::vector<u8> encoded;
+        for (i32 y {0}; y < rows; ++y, ++_row) {
+            std::copy_n(indices.data() + (static_cast<usize>(y) * width), width, line.data());
+            for (usize x {0}; x < _bytesPerLine;) {
+                u8 const value {line[x]};
+                usize    run {1};
+                while (run < 63 && x + run < _bytesPerLine && line[x + run] == value) { ++run; }
+                if (run > 1 || value >= 0xC0) { encoded.push_back(static_cast<u8>(0xC0 | run)); }
+                encoded.push_back(value);
+                x += run;
+            }
+        }
+        write(encoded);
+    }
+
+    auto finish() -> bool override
+    {
+        std::vector<u8> colors {0x0C};
+        for (usize i {0}; i < 256; ++i) {
+            color const c {i < _palette.size() ? _palette[i] : color {0, 0, 0, 255}};
+            colors.insert(colors.end(), {c.R, c.G, c.B});
+        }
+        write(colors);
+        _out.close();
+        return _row == _size.Height && !_out.fail();
+    }
+
+private:
+    usize _bytesPerLine;
+};
+
+// GIF LZW for one image: a flat (code, index) -> code table, reset once all 4096 codes are
+// taken; the code stream is handed out as data sub-blocks of up to 255 bytes
+class gif_lzw {
+public:
+    explicit gif_lzw(i32 bits)
+        : _bits {bits}
+        , _minCodeSize {std::max(2, bits)}
+        , _clearCode {1u << _minCodeSize}
+        , _table(MAX_CODES << bits, 0)
+        , _lzw {_stream}
+    {
+        reset();
+        _lzw.put(_clearCode, _codeSize);
+    }
+
+    auto min_code_size() const -> i32 { return _minCodeSize; }
+
+    void put(std::span<u8 const> indices)
+    {
+        u32 const alphabet {1u << _bits};
+        for (u8 const idx : indices) {
+            if (_prefix < 0) {
+                _prefix = idx;
+                continue;
+            }
+
+            u32 const slot {(static_cast<u32>(_prefix) * alphabet) + idx};
+            if (_table[slot] != 0) {
+                _prefix = _table[slot];
+                continue;
+            }
+
+            _lzw.put(static_cast<u32>(_prefix), _codeSize);
+            u32 const code {_nextCode++};
+            _table[slot] = static_cast<u16>(code);
+            if (code >= (1u << _codeSize)) { ++_codeSize; }
+            if (code == MAX_CODES - 1) {
+                _lzw.put(_clearCode, _codeSize);
+                reset();
+            }
+            _prefix = idx;
+        }
+    }
+
+    void finish()
+    {
+        if (_prefix >= 0) { _lzw.put(static_cast<u32>(_prefix), _codeSize); }
+        _lzw.put(_clearCode + 1, _codeSize);
+        _lzw.flush();
+    }
+
+    // full sub-blocks, the final call also writes the short one and the terminator
+    void write_blocks(std::ofstream& out, bool final)
+    {
+        usize pos {0};
+        while (_stream.size() - pos >= 255 || (final && pos < _stream.size())) {
+            usize const block {std::min<usize>(255, _stream.size() - pos)};
+            out.put(static_cast<char>(block));
+            out.write(reinterpret_cast<char const*>(_stream.data() + pos), static_cast<std::streamsize>(block));
+            pos += block;
+        }
+        _stream.erase(_stream.begin(), _stream.begin() + static_cast<isize>(pos));
+        if (final) { out.put(0); }
+    }
+
+private:
+    static constexpr u32 MAX_CODES {4096};
+
+    void reset()
+    {
+        std::ranges::fill(_table, u16 {0});
+        _codeSize = _minCodeSize + 1;
+        _nextCode = _clearCode + 2;
+    }
+
+    i32              _bits;
+    i32              _minCodeSize;
+    u32              _clearCode;
+    std::vector<u16> _table;
+    std::vector<u8>  _stream;
+    bit_writer       _lzw;
+    i32              _codeSize {0};
+    u32              _nextCode {0};
+    i32              _prefix {-1};
+};
+
+// 2^bits entries, unused ones are black
+void put_color_table(std::vector<u8>& out, std::span<color const> palette, i32 bits)
+{
+    for (usize i {0}; i < (usize {1} << bits); ++i) {
+        color const c {i < palette.size() ? palette[i] : color {0, 0, 0, 255}};
+        out.insert(out.end(), {c.R, c.G, c.B});
+    }
+}
+
+// GIF89a with a global color table, the first transparent palette entry becomes the
+// transparent index
+class gif_writer : public file_writer {
+public:
+    gif_writer(string const& file, size_i size, std::span<color const> palette)
+        : file_writer {file, size, palette, get_bit_depth(palette.size())}
+        , _lzw {_bits}
+    {
+        std::vector<u8> header {'G', 'I', 'F', '8', '9', 'a'};
+        put_le16(header, static_cast<u32>(size.Width));
+        put_le16(header, static_cast<u32>(size.Height));
+        header.insert(header.end(), {static_cast<u8>(0x80 | ((_bits - 1) << 4) | (_bits - 1)), 0, 0});
+        put_color_table(header, _palette, _bits);
+
+        auto const transparent {std::ranges::find_if(_palette, [](color const& c) { return c.A == 0; })};
+        if (transparent != _palette.end()) {
+            header.insert(header.end(), {0x21, 0xF9, 0x04, 0x01, 0, 0, static_cast<u8>(transparent - _palette.begin()), 0});
+        }
+
+        header.push_back(0x2C);
+        put_le16(header, 0);
+        put_le16(header, 0);
+        put_le16(header, static_cast<u32>(size.Width));
+        put_le16(header, static_cast<u32>(size.Height));
+        header.push_back(0);
+        header.push_back(static_cast<u8>(_lzw.min_code_size()));
+        write(header);
+    }
+
+    void write_rows(std::span<u8 const> indices) override
+    {
+        _row += rows_in(indices);
+        _lzw.put(indices);
+        _lzw.write_blocks(_out, false);
+    }
+
+    auto finish() -> bool override
+    {
+        _lzw.finish();
+        _lzw.write_blocks(_out, true);
+        write(std::array<u8, 1> {0x3B});
+        _out.close();
+        return _row == _size.Height && !_out.fail();
+    }
+
+private:
+    gif_lzw _lzw;
+};
+
+auto get_format(string const& file) -> string
+{
+    string retValue {io::get_extension(file)};
+    std::ranges::transform(retValue, retValue.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    return retValue;
+}
+
+}
+
+////////////////////////////////////////////////////////////
+
+auto indexed_image::color_count() const -> isize
+{
+    std::array<bool, 256> used {};
+    for (u8 const idx : Indices) { used[idx] = true; }
+    return std::ranges::count(used, true);
+}
+
+auto mark_transparent(gfx::image const& img, std::span<u8> indices, u8 transparent) -> bool
+{
+    if (img.info().Format != gfx::image::format::RGBA) { return false; }
+
+    auto const src {img.data()};
+    bool       retValue {false};
+    for (usize i {0}; i < indices.size(); ++i) {
+        if (src[(i * 4) + 3] < 128) {
+            indices[i] = transparent;
+            retValue   = true;
+        }
+    }
+    return retValue;
+}
+
+auto has_transparency(gfx::image const& img) -> bool
+{
+    if (img.info().Format != gfx::image::format::RGBA) { return false; }
+
+    auto const data {img.data()};
+    for (usize i {3}; i < data.size(); i += 4) {
+        if (data[i] < 128) { return true; }
+    }
+    return false;
+}
+
+auto make_indexed(gfx::image const& img, palette_matcher const& matcher, string const& dithering, i32 threads) -> std::optional<indexed_image>
+{
+    if (matcher.size() > 256) { return std::nullopt; }
+
+    auto const colors {matcher.colors()};
+
+    indexed_image retValue;
+    retValue.Size    = img.info().Size;
+    retValue.Indices = dither_indices(img, matcher, dithering, threads);
+    retValue.Palette.assign(colors.begin(), colors.end());
+
+    if (mark_transparent(img, retValue.Indices, static_cast<u8>(colors.size()))) {
+        if (colors.size() == 256) { return std::nullopt; }
+        retValue.Palette.push_back(color {0, 0, 0, 0});
+    }
+
+    return retValue;
+}
+
+////////////////////////////////////////////////////////////
+
+auto indexed_writer::Create(string const& file, size_i size, std::span<color const> palette) -> std::unique_ptr<indexed_writer>
+{
+    if (palette.empty() || palette.size() > 256 || size.Width <= 0 || size.Height <= 0) { return nullptr; }
+
+    std::unique_ptr<file_writer> retValue;
+
+    string const format {get_format(file)};
+    if (format == ".png") {
+        retValue = std::make_unique<png_writer>(file, size, palette);
+    } else if (format == ".bmp") {
+        retValue = std::make_unique<bmp_writer>(file, size, palette);
+    } else if (format == ".pcx") {
+        retValue = std::make_unique<pcx_writer>(file, size, palette);
+    } else if (format == ".gif") {
+        retValue = std::make_unique<gif_writer>(file, size, palette);
+    }
+
+    if (!retValue || !retValue->is_open()) { return nullptr; }
+    return retValue;
+}
+
+auto is_indexed_format(string const& file) -> bool
+{
+    string const format {get_format(file)};
+    return format == ".png" || format == ".bmp" || format == ".pcx" || format == ".gif";
+}
+
+auto save_indexed(indexed_image const& img, string const& file) -> std::optional<i32>
+{
+    auto writer {indexed_writer::Create(file, img.Size, img.Palette)};
+    if (!writer) { return std::nullopt; }
+
+    writer->write_rows(img.Indices);
+    if (!writer->finish()) { return std::nullopt; }
+    return writer->bit_depth();
+}
+
+auto save_animation(string const& file, size_i size, std::span<color const> palette, std::span<animation_frame const> frames) -> bool
+{
+    if (palette.empty() || frames.empty() || size.Width <= 0 || size.Height <= 0) { return false; }
+
+    usize colors {palette.size()};
+    for (auto const& frame : frames) { colors = std::max(colors, frame.Palette.size()); }
+    if (colors > 256) { return false; }
+    i32 const bits {get_bit_depth(colors)};
+
+    std::ofstream out {file, std::ios::binary | std::ios::trunc};
+    if (!out) { return false; }
+
+    std::vector<u8> block {'G', 'I', 'F', '8', '9', 'a'};
+    put_le16(block, static_cast<u32>(size.Width));
+    put_le16(block, static_cast<u32>(size.Height));
+    block.insert(block.end(), {static_cast<u8>(0x80 | ((bits - 1) << 4) | (bits - 1)), 0, 0});
+    put_color_table(block, palette, bits);
+    // NETSCAPE2.0 application extension, a loop count of 0 repeats forever
+    block.insert(block.end(), {0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0, 0, 0});
+
+    for (auto const& frame : frames) {
+        auto const& bounds {frame.Bounds};
+        if (bounds.Width <= 0 || bounds.Height <= 0 || bounds.X < 0 || bounds.Y < 0 || bounds.right() > size.Width || bounds.bottom() > size.Height
+            || frame.Indices.size() != static_cast<usize>(bounds.Width) * static_cast<usize>(bounds.Height)) {
+            return false;
+        }
+
+        // disposal method 1 leaves the frame in place for the next one to draw over, 2 clears it
+        bool const transparent {frame.Transparent >= 0};
+        block.insert(block.end(), {0x21, 0xF9, 0x04, static_cast<u8>((frame.Dispose ? 0x08 : 0x04) | (transparent ? 0x01 : 0x00))});
+        put_le16(block, static_cast<u32>(std::clamp(frame.Delay, 0, 0xFFFF)));
+        block.insert(block.end(), {static_cast<u8>(transparent ? frame.Transparent : 0), 0});
+
+        block.push_back(0x2C);
+        put_le16(block, static_cast<u32>(bounds.X));
+        put_le16(block, static_cast<u32>(bounds.Y));
+        put_le16(block, static_cast<u32>(bounds.Width));
+        put_le16(block, static_cast<u32>(bounds.Height));
+        if (frame.Palette.empty()) {
+            block.push_back(0);
+        } else {
+            block.push_back(static_cast<u8>(0x80 | (bits - 1)));
+            put_color_table(block, frame.Palette, bits);
+        }
+
+        gif_lzw lzw {bits};
+        block.push_back(static_cast<u8>(lzw.min_code_size()));
+        out.write(reinterpret_cast<char const*>(block.data()), std::ssize(block));
+        block.clear();
+
+        lzw.put(frame.Indices);
+        lzw.finish();
+        lzw.write_blocks(out, true);
+    }
+
+    out.put(0x3B);
+    out.close();
+    return !out.fail();
+}
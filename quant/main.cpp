@@ -5,50 +5,81 @@
 
 #include "../shared/argparse.hpp"
 
-#include <tcob/tcob.hpp>
-
-using namespace tcob;
-namespace io = tcob::io;
-using namespace tcob::gfx;
-
-auto print_error(string const& err) -> int
-{
-    std::cout << err;
-    return 1;
-}
+#include "common.hpp"
 
 template <typename T>
-auto doQuant(string const& dithering, image const& img, i32 colors, stopwatch& sw, string const& output) -> i32
+auto doQuant(options const& opts, gfx::image const& img, color_histogram const& hist, stopwatch& sw, string const& output) -> i32
 {
-    auto const& info {img.info()};
+    auto const&   info {img.info()};
+    string const& dithering {opts.Dithering};
+
+    auto const paletteSw {stopwatch::StartNew()};
+
+    std::vector<color> pal;
+    if (!opts.PaletteFile.empty()) {
+        auto loaded {read_palette(opts.PaletteFile)};
+        if (!loaded) { return print_error("error loading palette: " + opts.PaletteFile); }
+        pal = std::move(*loaded);
+    } else {
+        // indexed output keeps one entry free for transparent pixels
+        i32 const colors {opts.Indexed && has_transparency(img) ? std::min(opts.Colors, 255) : opts.Colors};
+        if constexpr (std::is_same_v<T, wu_quant>) {
+            // trains from the histogram, which is already compact
+            pal = T::GetPalette(hist, colors);
+        } else {
+            auto const training {make_training_image(img, opts.SampleRate, opts.MaxSamples)};
+            if (training) {
+                auto const& sampleSize {training->info().Size};
+                std::cout << std::format("training on {} of {} pixels\n", static_cast<i64>(sampleSize.Width) * sampleSize.Height, static_cast<i64>(info.Size.Width) * info.Size.Height);
+            }
+            pal = T::GetPalette(training ? *training : img, colors);
+        }
+    }
+    std::cout << std::format("palette: {} colors in {}ms\n", pal.size(), paletteSw.elapsed_milliseconds());
+    if (opts.PaletteFile.empty()) { pal = refine_palette(pal, hist, opts); }
+
+    if (!opts.SavePalette.empty() && !write_palette(opts.SavePalette, pal)) { return print_error("error saving palette: " + opts.SavePalette); }
+
+    palette_matcher matcher {pal, opts.ColorSpace};
 
-    image newImg;
-    auto  pal {T::GetPalette(img, colors)};
-
-    if (dithering == "bayer2") {
-        newImg = bayer_dither {pal, bayer_matrix::Bayer2x2}(img);
-    } else if (dithering == "bayer4") {
-        newImg = bayer_dither {pal, bayer_matrix::Bayer4x4}(img);
-    } else if (dithering == "bayer8") {
-        newImg = bayer_dither {pal, bayer_matrix::Bayer8x8}(img);
-    } else if (dithering == "atkinson") {
-        newImg = atkinson_dither {pal}(img);
-    } else if (dithering == "floyd-steinberg") {
-        newImg = floyd_steinberg_dither {pal}(img);
-    } else if (dithering == "noise1") {
-        newImg = value_noise_dither {pal, info.Size}(img);
-    } else if (dithering == "noise8") {
-        newImg = value_noise_dither {pal, info.Size / 8}(img);
-    } else if (dithering == "noise32") {
-        newImg = value_noise_dither {pal, info.Size / 32}(img);
+    if (opts.ColormapBits > 0) {
+        auto        cmSw {stopwatch::StartNew()};
+        isize const ambiguous {matcher.build_colormap(opts.ColormapBits, opts.ColormapExact, opts.Threads)};
+        i32 const   cells {1 << (3 * opts.ColormapBits)};
+        std::cout << std::format("colormap: {0}x{0}x{0} built in {1}ms, {2} ambiguous cells ({3:.1f}%)\n",
+                                 1 << opts.ColormapBits, cmSw.elapsed_milliseconds(), ambiguous, 100.0 * static_cast<f64>(ambiguous) / cells);
+    }
+
+    auto const ditherSw {stopwatch::StartNew()};
+
+    // indexed output never expands the palette colors into a full image
+    std::optional<indexed_image> indexed;
+    gfx::image                   newImg;
+    if (opts.Indexed) {
+        indexed = make_indexed(img, matcher, dithering, opts.Threads);
+        if (!indexed) { return print_error("indexed output supports at most 256 colors, including one for transparent pixels"); }
     } else {
-        newImg = nearest_dither {pal}(img);
+        newImg = dither_image(img, matcher, dithering, opts.Threads);
     }
 
-    std::cout << std::format("New color count:{}\n", newImg.count_colors());
+    auto const ditherMs {ditherSw.elapsed_milliseconds()};
+    f64 const  mpix {static_cast<f64>(info.Size.Width) * info.Size.Height / 1.0e6};
+    std::cout << std::format("dithering: {}ms, {:.1f} Mpix/s\n", ditherMs, ditherMs > 0 ? mpix / ditherMs * 1000.0 : 0.0);
+
+    f64 const mse {indexed ? mean_squared_error(img, *indexed) : mean_squared_error(img, newImg)};
+    f64 const deltaE {indexed ? mean_delta_e(img, *indexed) : mean_delta_e(img, newImg)};
+    std::cout << std::format("MSE: {:.2f}, PSNR: {:.2f}dB, mean deltaE: {:.2f}\n", mse, psnr(mse), deltaE);
+
+    std::cout << std::format("New color count:{}\n", indexed ? indexed->color_count() : color_histogram::Build(newImg, opts.Threads).color_count());
     auto const ms {sw.elapsed_milliseconds()};
 
-    if (newImg.save(output)) {
+    if (indexed) {
+        if (auto const bits {save_indexed(*indexed, output)}) {
+            std::cout << std::format("written with {} bit indices\n", *bits);
+            std::cout << std::format("done in {}ms!\n", ms);
+            return 0;
+        }
+    } else if (newImg.save(output)) {
         std::cout << std::format("done in {}ms!\n", ms);
         return 0;
     }
@@ -60,11 +91,11 @@ auto main(int argc, char* argv[]) -> int
     argparse::ArgumentParser program("quant");
     // Positional arguments
     program.add_argument("input")
-        .help("input image file path")
+        .help("input image file path, or a folder of png images to quantize with one shared palette")
         .metavar("INPUT");
 
     program.add_argument("output")
-        .help("output image file path")
+        .help("output image file path, or the output folder in batch mode")
         .metavar("OUTPUT");
 
     // Optional arguments with flags
@@ -77,14 +108,90 @@ auto main(int argc, char* argv[]) -> int
     program.add_argument("-q", "--quantizer")
         .help("quantization algorithm")
         .default_value("neuquant")
-        .choices("neuquant", "octree")
+        .choices("neuquant", "octree", "wu")
         .metavar("ALGO");
 
-    program.add_argument("-d", "--dithering")
-        .help("dithering algorithm")
-        .default_value("none")
-        .choices("none", "floyd-steinberg", "fs", "bayer2", "bayer4", "bayer8", "atkinson", "noise1", "noise8", "noise32")
-        .metavar("ALGO");
+    auto& dithering {program.add_argument("-d", "--dithering")
+                         .help("dithering algorithm; output differs from the tcob gfx dithering filters")
+                         .default_value("none")
+                         .metavar("ALGO")};
+    for (auto const name : DITHERINGS) { dithering.add_choice(name); }
+
+    program.add_argument("-j", "--threads")
+        .help("number of threads, 0 uses all cores")
+        .default_value(0)
+        .scan<'i', i32>()
+        .metavar("N");
+
+    program.add_argument("--color-space")
+        .help("color space for nearest color matching; oklab and lab match closer to perceived differences")
+        .default_value("rgb")
+        .choices("rgb", "oklab", "lab")
+        .metavar("SPACE");
+
+    program.add_argument("--colormap")
+        .help("map colors through a precomputed (2^BITS)^3 lookup table, 5 or 6 are good choices, 0 disables it")
+        .default_value(0)
+        .scan<'i', i32>()
+        .metavar("BITS");
+
+    program.add_argument("--colormap-exact")
+        .help("fall back to a full search for colormap cells without a unique nearest color")
+        .flag();
+
+    program.add_argument("--sample-rate")
+        .help("train neuquant and octree palettes on this fraction of the pixels, picked stratified")
+        .default_value(1.0)
+        .scan<'g', f64>()
+        .metavar("RATE");
+
+    program.add_argument("--max-samples")
+        .help("upper limit for the number of training pixels, 0 for no limit")
+        .default_value(i64 {0})
+        .scan<'i', i64>()
+        .metavar("N");
+
+    program.add_argument("-p", "--palette")
+        .help("use the colors of this .gpl palette instead of training one")
+        .default_value("")
+        .metavar("FILE");
+
+    program.add_argument("--save-palette")
+        .help("write the palette as .gpl file, for reuse with --palette")
+        .default_value("")
+        .metavar("FILE");
+
+    program.add_argument("--indexed")
+        .help("write 1, 2, 4 or 8 bit palette indices instead of RGB(A) pixels; output must be png, bmp, pcx or gif")
+        .flag();
+
+    program.add_argument("--tile-rows")
+        .help("stream a binary ppm/pam or bmp input in bands of N rows to an indexed png, bmp, pcx or gif, for images that don't fit in memory")
+        .default_value(0)
+        .scan<'i', i32>()
+        .metavar("N");
+
+    program.add_argument("--animation")
+        .help("treat the png files of the input folder, in name order, as frames of an animated gif with per-frame dirty rectangles")
+        .flag();
+
+    program.add_argument("--palette-window")
+        .help("animation: train a palette per N frames, together with the N before them; 0 shares one palette")
+        .default_value(0)
+        .scan<'i', i32>()
+        .metavar("N");
+
+    program.add_argument("--frame-delay")
+        .help("animation: time per frame in milliseconds")
+        .default_value(100)
+        .scan<'i', i32>()
+        .metavar("MS");
+
+    program.add_argument("--refine")
+        .help("refine the trained palette with up to N k-means iterations over the histogram")
+        .default_value(0)
+        .scan<'i', i32>()
+        .metavar("N");
 
     auto pl {platform::HeadlessInit()};
 
@@ -98,31 +205,57 @@ auto main(int argc, char* argv[]) -> int
 
     string const input {program.get<string>("input")};
     string const output {program.get<string>("output")};
-    i32 const    colors {program.get<i32>("--colors")};
 
     string const quantizer {program.get<string>("--quantizer")};
 
-    string dithering {program.get<string>("--dithering")};
-    if (dithering == "fs") { dithering = "floyd-steinberg"; }
+    options opts {
+        .Colors        = program.get<i32>("--colors"),
+        .Dithering     = program.get<string>("--dithering"),
+        .ColormapBits  = std::clamp(program.get<i32>("--colormap"), 0, 8),
+        .ColormapExact = program.get<bool>("--colormap-exact"),
+        .Threads       = program.get<i32>("--threads"),
+        .SampleRate    = program.get<f64>("--sample-rate"),
+        .MaxSamples    = program.get<i64>("--max-samples"),
+        .PaletteFile   = program.get<string>("--palette"),
+        .SavePalette   = program.get<string>("--save-palette"),
+        .Indexed       = program.get<bool>("--indexed"),
+        .TileRows      = std::max(0, program.get<i32>("--tile-rows")),
+        .ColorSpace    = parse_color_space(program.get<string>("--color-space")).value_or(color_space::RGB),
+        .Animation     = program.get<bool>("--animation"),
+        .PaletteWindow = std::max(0, program.get<i32>("--palette-window")),
+        .FrameDelay    = std::max(0, program.get<i32>("--frame-delay")),
+        .Refine        = std::max(0, program.get<i32>("--refine"))};
+    if (opts.Dithering == "fs") { opts.Dithering = "floyd-steinberg"; }
 
+    if (io::is_folder(input)) { return opts.Animation ? quantize_animation(opts, quantizer, input, output) : quantize_batch(opts, quantizer, input, output); }
+    if (opts.Animation) { return print_error("animation mode reads a folder of png frames: " + input); }
     if (!io::is_file(input)) { return print_error("file not found: " + input); }
+    if (opts.TileRows > 0) { return quantize_tiled(opts, quantizer, input, output); }
+    if (opts.Indexed && !is_indexed_format(output)) { return print_error("indexed output needs a png, bmp, pcx or gif file: " + output); }
 
     auto in {std::make_shared<io::ifstream>(input)};
     auto sig {io::magic::get_signature(*in)};
     if (!sig) { return print_error("invalid file: " + input); }
-    std::cout << std::format("converting image to {} colors: {} to {} \n", colors, input, output);
+    std::cout << std::format("converting image to {} colors: {} to {} \n", opts.Colors, input, output);
 
     in->seek(0, io::seek_dir::Begin);
 
-    image img;
+    gfx::image img;
     if (!img.load(*in, sig->Extension)) { return print_error("error loading image: " + input); }
 
     auto const& info {img.info()};
-    std::cout << std::format("source info: BPP: {}, Width: {}, Height: {} \n", (info.Format == image::format::RGBA ? 4 : 3), info.Size.Width, info.Size.Height);
-    std::cout << std::format("Old color count:{}\n", img.count_colors());
+    std::cout << std::format("source info: BPP: {}, Width: {}, Height: {} \n", (info.Format == gfx::image::format::RGBA ? 4 : 3), info.Size.Width, info.Size.Height);
 
     stopwatch sw {stopwatch::StartNew()};
 
-    if (quantizer == "neuquant") { return doQuant<neuquant>(dithering, img, colors, sw, output); }
-    return doQuant<octree_quant>(dithering, img, colors, sw, output);
+    // a given palette skips training, so the histogram isn't needed either
+    color_histogram hist;
+    if (opts.PaletteFile.empty()) {
+        hist = color_histogram::Build(img, opts.Threads);
+        std::cout << std::format("Old color count:{}\n", hist.color_count());
+    }
+
+    if (quantizer == "neuquant") { return doQuant<gfx::neuquant>(opts, img, hist, sw, output); }
+    if (quantizer == "wu") { return doQuant<wu_quant>(opts, img, hist, sw, output); }
+    return doQuant<gfx::octree_quant>(opts, img, hist, sw, output);
 }
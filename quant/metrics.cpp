@@ -0,0 +1,208 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+namespace {
+
+// collects color pairs and converts them to CIELAB in chunks
+class delta_e_sum {
+public:
+    void add(color a, color b)
+    {
+        _a.push_back(a);
+        _b.push_back(b);
+        if (_a.size() == CHUNK_SIZE) { flush(); }
+    }
+
+    auto mean() -> f64
+    {
+        flush();
+        return _count > 0 ? _sum / static_cast<f64>(_count) : 0.0;
+    }
+
+private:
+    static constexpr usize CHUNK_SIZE {4096};
+
+    void flush()
+    {
+        std::vector<std::array<f32, 3>> labA(_a.size());
+        std::vector<std::array<f32, 3>> labB(_b.size());
+        convert_colors(color_space::CIELAB, _a, labA);
+        convert_colors(color_space::CIELAB, _b, labB);
+        for (usize i {0}; i < _a.size(); ++i) {
+            f64 const dl {labA[i][0] - labB[i][0]};
+            f64 const da {labA[i][1] - labB[i][1]};
+            f64 const db {labA[i][2] - labB[i][2]};
+            _sum += std::sqrt((dl * dl) + (da * da) + (db * db)) / CIELAB_SCALE;
+        }
+        _count += static_cast<isize>(_a.size());
+        _a.clear();
+        _b.clear();
+    }
+
+    std::vector<color> _a;
+    std::vector<color> _b;
+    f64                _sum {0.0};
+    isize              _count {0};
+};
+
+}
+
+////////////////////////////////////////////////////////////
+
+auto mean_squared_error(gfx::image const& a, gfx::image const& b) -> f64
+{
+    auto const& info {a.info()};
+    i32 const   bppA {info.bytes_per_pixel()};
+    i32 const   bppB {b.info().bytes_per_pixel()};
+    auto const  dataA {a.data()};
+    auto const  dataB {b.data()};
+
+    isize const pixels {static_cast<isize>(info.Size.Width) * info.Size.Height};
+    if (pixels == 0 || b.info().Size != info.Size) { return 0.0; }
+
+    i64 sum {0};
+    for (isize i {0}; i < pixels; ++i) {
+        for (isize c {0}; c < 3; ++c) {
+            i64 const d {dataA[(i * bppA) + c] - dataB[(i * bppB) + c]};
+            sum += d * d;
+        }
+    }
+    return static_cast<f64>(sum) / static_cast<f64>(pixels * 3);
+}
+
+auto mean_squared_error(gfx::image const& a, indexed_image const& b) -> f64
+{
+    auto const& info {a.info()};
+    i32 const   bpp {info.bytes_per_pixel()};
+    auto const  data {a.data()};
+
+    isize const pixels {static_cast<isize>(info.Size.Width) * info.Size.Height};
+    if (pixels == 0 || b.Size != info.Size) { return 0.0; }
+
+    // transparent entries have no color to compare against
+    i64   sum {0};
+    isize counted {0};
+    for (isize i {0}; i < pixels; ++i) {
+        color const c {b.Palette[b.Indices[i]]};
+        if (c.A == 0) { continue; }
+
+        u8 const* p {data.data() + (i * bpp)};
+        i64 const dr {p[0] - c.R};
+        i64 const dg {p[1] - c.G};
+        i64 const db {p[2] - c.B};
+        sum += (dr * dr) + (dg * dg) + (db * db);
+        ++counted;
+    }
+    return counted > 0 ? static_cast<f64>(sum) / static_cast<f64>(counted * 3) : 0.0;
+}
+
+auto psnr(f64 mse) -> f64
+{
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<f64>::infinity();
+}
+
+auto ssim(gfx::image const& a, gfx::image const& b) -> f64
+{
+    auto const& info {a.info()};
+    if (b.info().Size != info.Size || info.Size.Width <= 0 || info.Size.Height <= 0) { return 0.0; }
+
+    auto const luma {[](gfx::image const& img) {
+        i32 const        bpp {img.info().bytes_per_pixel()};
+        auto const       data {img.data()};
+        std::vector<f32> retValue(data.size() / static_cast<usize>(bpp));
+        for (usize i {0}; i < retValue.size(); ++i) {
+            u8 const* p {data.data() + (i * static_cast<usize>(bpp))};
+            retValue[i] = (0.299f * p[0]) + (0.587f * p[1]) + (0.114f * p[2]);
+        }
+        return retValue;
+    }};
+    auto const lumaA {luma(a)};
+    auto const lumaB {luma(b)};
+
+    constexpr i32 WINDOW {8};
+    constexpr i32 STEP {4};
+    constexpr f64 C1 {(0.01 * 255.0) * (0.01 * 255.0)};
+    constexpr f64 C2 {(0.03 * 255.0) * (0.03 * 255.0)};
+
+    i32 const width {info.Size.Width};
+    i32 const winX {std::min(WINDOW, width)};
+    i32 const winY {std::min(WINDOW, info.Size.Height)};
+    f64 const n {static_cast<f64>(winX * winY)};
+
+    f64   sum {0.0};
+    isize windows {0};
+    for (i32 y {0}; y + winY <= info.Size.Height; y += STEP) {
+        for (i32 x {0}; x + winX <= width; x += STEP) {
+            f64 sa {0.0};
+            f64 sb {0.0};
+            f64 saa {0.0};
+            f64 sbb {0.0};
+            f64 sab {0.0};
+            for (i32 wy {0}; wy < winY; ++wy) {
+                usize const row {(static_cast<usize>(y + wy) * static_cast<usize>(width)) + static_cast<usize>(x)};
+                for (i32 wx {0}; wx < winX; ++wx) {
+                    f64 const va {lumaA[row + static_cast<usize>(wx)]};
+                    f64 const vb {lumaB[row + static_cast<usize>(wx)]};
+                    sa += va;
+                    sb += vb;
+                    saa += va * va;
+                    sbb += vb * vb;
+                    sab += va * vb;
+                }
+            }
+
+            f64 const meanA {sa / n};
+            f64 const meanB {sb / n};
+            f64 const varA {(saa / n) - (meanA * meanA)};
+            f64 const varB {(sbb / n) - (meanB * meanB)};
+            f64 const cov {(sab / n) - (meanA * meanB)};
+            sum += ((2.0 * meanA * meanB) + C1) * ((2.0 * cov) + C2) / (((meanA * meanA) + (meanB * meanB) + C1) * (varA + varB + C2));
+            ++windows;
+        }
+    }
+    return windows > 0 ? sum / static_cast<f64>(windows) : 0.0;
+}
+
+auto mean_delta_e(gfx::image const& a, gfx::image const& b) -> f64
+{
+    auto const& info {a.info()};
+    i32 const   bppA {info.bytes_per_pixel()};
+    i32 const   bppB {b.info().bytes_per_pixel()};
+    auto const  dataA {a.data()};
+    auto const  dataB {b.data()};
+
+    isize const pixels {static_cast<isize>(info.Size.Width) * info.Size.Height};
+    if (pixels == 0 || b.info().Size != info.Size) { return 0.0; }
+
+    delta_e_sum sum;
+    for (isize i {0}; i < pixels; ++i) {
+        u8 const* pa {dataA.data() + (i * bppA)};
+        u8 const* pb {dataB.data() + (i * bppB)};
+        sum.add({pa[0], pa[1], pa[2], 255}, {pb[0], pb[1], pb[2], 255});
+    }
+    return sum.mean();
+}
+
+auto mean_delta_e(gfx::image const& a, indexed_image const& b) -> f64
+{
+    auto const& info {a.info()};
+    i32 const   bpp {info.bytes_per_pixel()};
+    auto const  data {a.data()};
+
+    isize const pixels {static_cast<isize>(info.Size.Width) * info.Size.Height};
+    if (pixels == 0 || b.Size != info.Size) { return 0.0; }
+
+    delta_e_sum sum;
+    for (isize i {0}; i < pixels; ++i) {
+        color const c {b.Palette[b.Indices[i]]};
+        if (c.A == 0) { continue; }
+
+        u8 const* p {data.data() + (i * bpp)};
+        sum.add({p[0], p[1], p[2], 255}, c);
+    }
+    return sum.mean();
+}
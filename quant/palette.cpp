@@ -0,0 +1,421 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "../shared/parallel.hpp"
+#include "common.hpp"
+
+#include <atomic>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define QUANT_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define QUANT_SSE2
+#endif
+
+// entries per SIMD step; the SoA arrays are padded to a multiple of this
+constexpr usize LANES {8};
+
+// Each candidate is reduced to one integer key (distance << INDEX_BITS | index), so a plain
+// integer min picks the nearest color and, on ties, the lowest index, exactly like nearest_scalar.
+// Distances stay below 2^20, which leaves 11 bits for the index.
+constexpr i32 INDEX_BITS {11};
+constexpr i32 INDEX_MASK {(1 << INDEX_BITS) - 1};
+constexpr i32 MAX_SIMD_COLORS {1 << INDEX_BITS};
+
+// padding entries lose against every real color but keep the key below 2^31;
+// Oklab and CIELAB coordinates are signed, so their padding sits far out on the lightness axis
+constexpr std::array<f32, 3> RGB_PADDING {520.0f, 520.0f, 520.0f};
+constexpr std::array<f32, 3> OKLAB_PADDING {900.0f, 0.0f, 0.0f};
+constexpr std::array<f32, 3> CIELAB_PADDING {800.0f, 0.0f, 0.0f};
+
+// palettes from this size on are searched through the k-d tree, see quant_bench
+#if defined(QUANT_AVX2)
+constexpr i32 INDEX_THRESHOLD {512};
+#else
+constexpr i32 INDEX_THRESHOLD {128};
+#endif
+
+// maximum number of entries per k-d tree leaf, scanned linearly
+constexpr i32 LEAF_SIZE {4};
+
+// colormap cells without a unique nearest color
+constexpr u16 AMBIGUOUS {std::numeric_limits<u16>::max()};
+
+namespace {
+
+auto get_padding(color_space space) -> std::array<f32, 3> const&
+{
+    return space == color_space::Oklab ? OKLAB_PADDING : space == color_space::CIELAB ? CIELAB_PADDING : RGB_PADDING;
+}
+
+// nearest of count entries of padded SoA arrays; a std::integral_constant count fixes the trip count
+template <typename Count>
+auto search_linear(f32 const* xs, f32 const* ys, f32 const* zs, Count count, i32 x, i32 y, i32 z) -> i32
+{
+#if defined(QUANT_AVX2)
+    __m256 const  vx {_mm256_set1_ps(static_cast<f32>(x))};
+    __m256 const  vy {_mm256_set1_ps(static_cast<f32>(y))};
+    __m256 const  vz {_mm256_set1_ps(static_cast<f32>(z))};
+    __m256i const step {_mm256_set1_epi32(LANES)};
+    __m256i       idx {_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)};
+    __m256i       best {_mm256_set1_epi32(std::numeric_limits<i32>::max())};
+
+    for (usize i {0}; i < count; i += LANES) {
+        __m256 const  dx {_mm256_sub_ps(_mm256_loadu_ps(&xs[i]), vx)};
+        __m256 const  dy {_mm256_sub_ps(_mm256_loadu_ps(&ys[i]), vy)};
+        __m256 const  dz {_mm256_sub_ps(_mm256_loadu_ps(&zs[i]), vz)};
+        __m256 const  dist {_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz))};
+        __m256i const key {_mm256_or_si256(_mm256_slli_epi32(_mm256_cvttps_epi32(dist), INDEX_BITS), idx)};
+        best = _mm256_min_epi32(best, key);
+        idx  = _mm256_add_epi32(idx, step);
+    }
+
+    __m128i m {_mm_min_epi32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1))};
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, 0x4E));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, 0xB1));
+    return _mm_cvtsi128_si32(m) & INDEX_MASK;
+#elif defined(QUANT_SSE2)
+    // SSE2 has no signed 32-bit min, keys are non-negative so compare and blend
+    auto const min {[](__m128i a, __m128i b) {
+        __m128i const mask {_mm_cmplt_epi32(a, b)};
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }};
+
+    __m128 const  vx {_mm_set1_ps(static_cast<f32>(x))};
+    __m128 const  vy {_mm_set1_ps(static_cast<f32>(y))};
+    __m128 const  vz {_mm_set1_ps(static_cast<f32>(z))};
+    __m128i const step {_mm_set1_epi32(LANES)};
+
+    // two independent 4-wide accumulators cover 8 entries per step
+    __m128i idx0 {_mm_setr_epi32(0, 1, 2, 3)};
+    __m128i idx1 {_mm_setr_epi32(4, 5, 6, 7)};
+    __m128i best0 {_mm_set1_epi32(std::numeric_limits<i32>::max())};
+    __m128i best1 {best0};
+
+    auto const key {[&](usize i, __m128i idx) {
+        __m128 const dx {_mm_sub_ps(_mm_loadu_ps(&xs[i]), vx)};
+        __m128 const dy {_mm_sub_ps(_mm_loadu_ps(&ys[i]), vy)};
+        __m128 const dz {_mm_sub_ps(_mm_loadu_ps(&zs[i]), vz)};
+        __m128 const dist {_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz))};
+        return _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(dist), INDEX_BITS), idx);
+    }};
+
+    for (usize i {0}; i < count; i += LANES) {
+        best0 = min(best0, key(i, idx0));
+        best1 = min(best1, key(i + 4, idx1));
+        idx0  = _mm_add_epi32(idx0, step);
+        idx1  = _mm_add_epi32(idx1, step);
+    }
+
+    __m128i m {min(best0, best1)};
+    m = min(m, _mm_shuffle_epi32(m, 0x4E));
+    m = min(m, _mm_shuffle_epi32(m, 0xB1));
+    return _mm_cvtsi128_si32(m) & INDEX_MASK;
+#else
+    auto const fx {static_cast<f32>(x)};
+    auto const fy {static_cast<f32>(y)};
+    auto const fz {static_cast<f32>(z)};
+    i32        best {std::numeric_limits<i32>::max()};
+    for (usize i {0}; i < count; ++i) {
+        f32 const dx {xs[i] - fx};
+        f32 const dy {ys[i] - fy};
+        f32 const dz {zs[i] - fz};
+        i32 const key {(static_cast<i32>((dx * dx) + (dy * dy) + (dz * dz)) << INDEX_BITS) | static_cast<i32>(i)};
+        best = std::min(best, key);
+    }
+    return best & INDEX_MASK;
+#endif
+}
+
+
+}
+
+palette_matcher::palette_matcher(std::span<color const> palette, color_space space)
+    : _colors {palette.begin(), palette.end()}
+    , _space {space}
+    , _coords(palette.size())
+{
+    convert_colors(space, palette, _coords);
+
+    auto const& padding {get_padding(space)};
+    usize const padded {((palette.size() + LANES - 1) / LANES) * LANES};
+    _x.assign(padded, padding[0]);
+    _y.assign(padded, padding[1]);
+    _z.assign(padded, padding[2]);
+    for (usize i {0}; i < palette.size(); ++i) {
+        _x[i] = static_cast<f32>(_coords[i][0]);
+        _y[i] = static_cast<f32>(_coords[i][1]);
+        _z[i] = static_cast<f32>(_coords[i][2]);
+    }
+
+    _entries.reserve(palette.size());
+    for (usize i {0}; i < palette.size(); ++i) {
+        _entries.push_back({_coords[i][0], _coords[i][1], _coords[i][2], static_cast<i32>(i)});
+    }
+    if (!_entries.empty()) { build_node(0, static_cast<i32>(_entries.size())); }
+    _useIndex = size() >= INDEX_THRESHOLD;
+}
+
+auto palette_matcher::build_node(i32 begin, i32 end) -> i32
+{
+    i32 const retValue {static_cast<i32>(_nodes.size())};
+    _nodes.push_back({begin, end, -1, 0, 0});
+    if (end - begin <= LEAF_SIZE) { return retValue; }
+
+    // split the widest axis at the median
+    std::array<i32, 3> lo {};
+    std::array<i32, 3> hi {};
+    lo.fill(std::numeric_limits<i32>::max());
+    hi.fill(std::numeric_limits<i32>::min());
+    for (i32 i {begin}; i < end; ++i) {
+        std::array<i32, 3> const c {_entries[i].X, _entries[i].Y, _entries[i].Z};
+        for (i32 a {0}; a < 3; ++a) {
+            lo[a] = std::min(lo[a], c[a]);
+            hi[a] = std::max(hi[a], c[a]);
+        }
+    }
+    i32 axis {0};
+    for (i32 a {1}; a < 3; ++a) {
+        if (hi[a] - lo[a] > hi[axis] - lo[axis]) { axis = a; }
+    }
+
+    auto const value {[axis](kd_entry const& e) { return axis == 0 ? e.X : axis == 1 ? e.Y : e.Z; }};
+    i32 const  mid {begin + ((end - begin) / 2)};
+    std::nth_element(_entries.begin() + begin, _entries.begin() + mid, _entries.begin() + end,
+                     [&](kd_entry const& a, kd_entry const& b) { return value(a) < value(b); });
+
+    _nodes[retValue].Axis  = axis;
+    _nodes[retValue].Split = value(_entries[mid]);
+    build_node(begin, mid);
+    i32 const right {build_node(mid, end)};
+    _nodes[retValue].Right = right;
+    return retValue;
+}
+
+void palette_matcher::search_node(i32 node, std::array<i32, 3> const& query, i32& best, i32& bestDist) const
+{
+    kd_node const& n {_nodes[node]};
+    if (n.Right < 0) {
+        for (i32 i {n.Begin}; i < n.End; ++i) {
+            kd_entry const& e {_entries[i]};
+            i32 const       dx {e.X - query[0]};
+            i32 const       dy {e.Y - query[1]};
+            i32 const       dz {e.Z - query[2]};
+            i32 const       dist {(dx * dx) + (dy * dy) + (dz * dz)};
+            if (dist < bestDist || (dist == bestDist && e.Index < best)) {
+                bestDist = dist;
+                best     = e.Index;
+            }
+        }
+        return;
+    }
+
+    // entries equal to the split value may sit on either side
+    i32 const  diff {query[n.Axis] - n.Split};
+    bool const goLeft {diff < 0};
+    search_node(goLeft ? node + 1 : n.Right, query, best, bestDist);
+    // only prune when strictly farther, so equally distant entries with a lower index are still found
+    if (diff * diff <= bestDist) { search_node(goLeft ? n.Right : node + 1, query, best, bestDist); }
+}
+
+auto palette_matcher::colors() const -> std::span<color const>
+{
+    return _colors;
+}
+
+auto palette_matcher::size() const -> i32
+{
+    return static_cast<i32>(_colors.size());
+}
+
+auto palette_matcher::space() const -> color_space
+{
+    return _space;
+}
+
+auto palette_matcher::nearest_scalar(i32 x, i32 y, i32 z) const -> i32
+{
+    i32 best {0};
+    i32 bestDist {std::numeric_limits<i32>::max()};
+    for (i32 i {0}; i < size(); ++i) {
+        i32 const dx {_coords[i][0] - x};
+        i32 const dy {_coords[i][1] - y};
+        i32 const dz {_coords[i][2] - z};
+        i32 const dist {(dx * dx) + (dy * dy) + (dz * dz)};
+        if (dist < bestDist) {
+            bestDist = dist;
+            best     = i;
+        }
+    }
+    return best;
+}
+
+auto palette_matcher::build_colormap(i32 bits, bool exact, i32 threads) -> isize
+{
+    bits = std::clamp(bits, 1, 8);
+    if (_colors.empty() || size() >= AMBIGUOUS) { return 0; }
+
+    i32 const cells {1 << bits};
+    i32 const step {1 << (8 - bits)};
+
+    _colormapBits = bits;
+    _colormap.assign(static_cast<usize>(cells) * cells * cells, AMBIGUOUS);
+
+    // The winner at the cell center is exact if no other entry gets closer anywhere in the cell.
+    // |x-p|^2 - |x-q|^2 is linear in x, so it is enough to check the worst corner per entry.
+    auto const unique {[&](i32 best, std::array<i32, 3> const& lo) {
+        color const& p {_colors[best]};
+        i32 const    pp {(p.R * p.R) + (p.G * p.G) + (p.B * p.B)};
+        for (i32 j {0}; j < size(); ++j) {
+            if (j == best) { continue; }
+            color const&             q {_colors[j]};
+            std::array<i32, 3> const coeff {2 * (q.R - p.R), 2 * (q.G - p.G), 2 * (q.B - p.B)};
+            i32                      worst {pp - ((q.R * q.R) + (q.G * q.G) + (q.B * q.B))};
+            for (i32 a {0}; a < 3; ++a) {
+                worst += coeff[a] * (coeff[a] > 0 ? lo[a] + step - 1 : lo[a]);
+            }
+            // ties go to the lower index
+            if (worst > 0 || (worst == 0 && j < best)) { return false; }
+        }
+        return true;
+    }};
+
+    // the nearest color must be the same at all eight corners of the cell
+    auto const corners {[&](i32 best, std::array<i32, 3> const& lo) {
+        std::array<color, 8>              points {};
+        std::array<std::array<i32, 3>, 8> coords {};
+        for (usize i {0}; i < points.size(); ++i) {
+            points[i] = {static_cast<u8>(lo[0] + ((i & 4) != 0 ? step - 1 : 0)), static_cast<u8>(lo[1] + ((i & 2) != 0 ? step - 1 : 0)),
+                         static_cast<u8>(lo[2] + ((i & 1) != 0 ? step - 1 : 0)), 255};
+        }
+        convert_colors(_space, points, coords);
+        return std::ranges::all_of(coords, [&](auto const& c) { return nearest_linear(c[0], c[1], c[2]) == best; });
+    }};
+
+    std::atomic<isize> ambiguous {0};
+    parallel_for(cells, threads, [&](isize begin, isize end) {
+        isize                           localAmbiguous {0};
+        std::vector<color>              centers(static_cast<usize>(cells));
+        std::vector<std::array<i32, 3>> coords(centers.size());
+        for (isize r {begin}; r < end; ++r) {
+            for (i32 g {0}; g < cells; ++g) {
+                // one row of cell centers is converted at once
+                for (i32 b {0}; b < cells; ++b) {
+                    centers[b] = {static_cast<u8>((static_cast<i32>(r) * step) + (step / 2)), static_cast<u8>((g * step) + (step / 2)), static_cast<u8>((b * step) + (step / 2)), 255};
+                }
+                convert_colors(_space, centers, coords);
+
+                for (i32 b {0}; b < cells; ++b) {
+                    std::array<i32, 3> const lo {static_cast<i32>(r) * step, g * step, b * step};
+                    i32 const                best {nearest_linear(coords[b][0], coords[b][1], coords[b][2])};
+
+                    usize const cell {(static_cast<usize>(r) << (2 * bits)) | (static_cast<usize>(g) << bits) | static_cast<usize>(b)};
+                    if (!exact || (_space == color_space::RGB ? unique(best, lo) : corners(best, lo))) {
+                        _colormap[cell] = static_cast<u16>(best);
+                    } else {
+                        ++localAmbiguous;
+                    }
+                }
+            }
+        }
+        ambiguous += localAmbiguous;
+    });
+
+    return ambiguous;
+}
+
+auto palette_matcher::has_colormap() const -> bool
+{
+    return !_colormap.empty();
+}
+
+auto palette_matcher::has_index() const -> bool
+{
+    return _useIndex;
+}
+
+auto palette_matcher::nearest(i32 r, i32 g, i32 b) const -> i32
+{
+    if (!_colormap.empty()) {
+        i32 const shift {8 - _colormapBits};
+        u16 const idx {_colormap[(static_cast<usize>(r >> shift) << (2 * _colormapBits)) | (static_cast<usize>(g >> shift) << _colormapBits) | static_cast<usize>(b >> shift)]};
+        if (idx != AMBIGUOUS) { return idx; }
+    }
+
+    auto const [x, y, z] {_space == color_space::RGB ? std::array<i32, 3> {r, g, b} : convert_color(_space, r, g, b)};
+    return _useIndex ? nearest_indexed(x, y, z) : nearest_linear(x, y, z);
+}
+
+auto palette_matcher::nearest_indexed(i32 x, i32 y, i32 z) const -> i32
+{
+    if (_nodes.empty()) { return 0; }
+
+    i32 best {0};
+    i32 bestDist {std::numeric_limits<i32>::max()};
+    search_node(0, {x, y, z}, best, bestDist);
+    return best;
+}
+
+auto palette_matcher::nearest_linear(i32 x, i32 y, i32 z) const -> i32
+{
+    if (size() > MAX_SIMD_COLORS) { return nearest_scalar(x, y, z); }
+
+    return search_linear(_x.data(), _y.data(), _z.data(), _x.size(), x, y, z);
+}
+
+////////////////////////////////////////////////////////////
+
+template <i32 N>
+fixed_palette_matcher<N>::fixed_palette_matcher(palette_matcher const& matcher)
+    : _colors {matcher.colors()}
+    , _space {matcher.space()}
+{
+    auto const& padding {get_padding(_space)};
+    _x.fill(padding[0]);
+    _y.fill(padding[1]);
+    _z.fill(padding[2]);
+    usize const count {std::min(SLOTS, matcher._x.size())};
+    std::copy_n(matcher._x.begin(), count, _x.begin());
+    std::copy_n(matcher._y.begin(), count, _y.begin());
+    std::copy_n(matcher._z.begin(), count, _z.begin());
+}
+
+template <i32 N>
+auto fixed_palette_matcher<N>::colors() const -> std::span<color const>
+{
+    return _colors;
+}
+
+template <i32 N>
+auto fixed_palette_matcher<N>::size() const -> i32
+{
+    return static_cast<i32>(_colors.size());
+}
+
+template <i32 N>
+auto fixed_palette_matcher<N>::nearest(i32 r, i32 g, i32 b) const -> i32
+{
+    auto const [x, y, z] {_space == color_space::RGB ? std::array<i32, 3> {r, g, b} : convert_color(_space, r, g, b)};
+    if constexpr (SLOTS < LANES) {
+        i32 best {std::numeric_limits<i32>::max()};
+        for (usize i {0}; i < SLOTS; ++i) {
+            f32 const dx {_x[i] - static_cast<f32>(x)};
+            f32 const dy {_y[i] - static_cast<f32>(y)};
+            f32 const dz {_z[i] - static_cast<f32>(z)};
+            best = std::min(best, (static_cast<i32>((dx * dx) + (dy * dy) + (dz * dz)) << INDEX_BITS) | static_cast<i32>(i));
+        }
+        return best & INDEX_MASK;
+    } else {
+        static_assert(SLOTS % LANES == 0);
+        return search_linear(_x.data(), _y.data(), _z.data(), std::integral_constant<usize, SLOTS> {}, x, y, z);
+    }
+}
+
+template class fixed_palette_matcher<2>;
+template class fixed_palette_matcher<4>;
+template class fixed_palette_matcher<16>;
+template class fixed_palette_matcher<256>;
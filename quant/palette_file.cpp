@@ -0,0 +1,45 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+#include <fstream>
+
+// GIMP palette, plain text and readable by most image editors
+auto write_palette(string const& file, std::span<color const> palette) -> bool
+{
+    std::ofstream out {file, std::ios::trunc};
+    if (!out) { return false; }
+
+    out << "GIMP Palette\nName: " << io::get_stem(file) << "\nColumns: 16\n#\n";
+    for (usize i {0}; i < palette.size(); ++i) {
+        color const& c {palette[i]};
+        out << std::format("{:3} {:3} {:3}\tIndex {}\n", c.R, c.G, c.B, i);
+    }
+    return static_cast<bool>(out);
+}
+
+auto read_palette(string const& file) -> std::optional<std::vector<color>>
+{
+    std::ifstream in {file};
+    if (!in) { return std::nullopt; }
+
+    string line;
+    if (!std::getline(in, line) || !line.starts_with("GIMP Palette")) { return std::nullopt; }
+
+    std::vector<color> retValue;
+    while (std::getline(in, line)) {
+        if (line.empty() || line.starts_with('#') || line.starts_with("Name:") || line.starts_with("Columns:")) { continue; }
+
+        i32 r {0};
+        i32 g {0};
+        i32 b {0};
+        if (std::sscanf(line.c_str(), "%d %d %d", &r, &g, &b) != 3) { return std::nullopt; }
+        retValue.push_back(color {static_cast<u8>(std::clamp(r, 0, 255)), static_cast<u8>(std::clamp(g, 0, 255)), static_cast<u8>(std::clamp(b, 0, 255)), 255});
+    }
+
+    if (retValue.empty()) { return std::nullopt; }
+    return retValue;
+}
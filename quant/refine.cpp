@@ -0,0 +1,154 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "../shared/parallel.hpp"
+#include "common.hpp"
+
+#include <mutex>
+#include <numeric>
+
+namespace {
+
+// per palette entry: weighted channel sums and the number of pixels assigned to it
+struct cluster {
+    i64 R {0};
+    i64 G {0};
+    i64 B {0};
+    i64 Count {0};
+};
+
+struct assignment {
+    std::vector<cluster> Clusters;
+    std::vector<i64>     Errors; // squared error times count, per histogram entry
+    i64                  SquaredError {0};
+};
+
+// nearest palette entry for every histogram color, through the SIMD search or the k-d tree;
+// coords are the histogram colors in the matcher's color space
+auto assign(palette_matcher const& matcher, std::span<color_histogram::entry const> entries, std::span<std::array<i32, 3> const> coords, i32 threads) -> assignment
+{
+    auto const                      palette {matcher.colors()};
+    std::vector<std::array<i32, 3>> paletteCoords(palette.size());
+    convert_colors(matcher.space(), palette, paletteCoords);
+
+    assignment retValue;
+    retValue.Clusters.resize(palette.size());
+    retValue.Errors.resize(entries.size());
+
+    std::mutex mutex;
+    parallel_for(std::ssize(entries), threads, [&](isize begin, isize end) {
+        std::vector<cluster> local(palette.size());
+        for (isize i {begin}; i < end; ++i) {
+            auto const [x, y, z] {coords[i]};
+            i32 const idx {matcher.has_index() ? matcher.nearest_indexed(x, y, z) : matcher.nearest_linear(x, y, z)};
+            color const c {entries[i].get_color()};
+            i64 const   count {entries[i].Count};
+
+            cluster& k {local[idx]};
+            k.R += c.R * count;
+            k.G += c.G * count;
+            k.B += c.B * count;
+            k.Count += count;
+
+            i64 const dx {x - paletteCoords[idx][0]};
+            i64 const dy {y - paletteCoords[idx][1]};
+            i64 const dz {z - paletteCoords[idx][2]};
+            retValue.Errors[i] = ((dx * dx) + (dy * dy) + (dz * dz)) * count;
+        }
+
+        std::scoped_lock lock {mutex};
+        for (usize k {0}; k < local.size(); ++k) {
+            retValue.Clusters[k].R += local[k].R;
+            retValue.Clusters[k].G += local[k].G;
+            retValue.Clusters[k].B += local[k].B;
+            retValue.Clusters[k].Count += local[k].Count;
+        }
+    });
+    retValue.SquaredError = std::reduce(retValue.Errors.begin(), retValue.Errors.end(), i64 {0});
+    return retValue;
+}
+
+}
+
+////////////////////////////////////////////////////////////
+
+auto refine_palette(std::span<color const> palette, color_histogram const& hist, color_space space, i32 iterations, i32 threads) -> refine_result
+{
+    refine_result retValue {.Palette = {palette.begin(), palette.end()}, .Mse = {}};
+
+    auto const entries {hist.entries()};
+    if (palette.empty() || entries.empty()) { return retValue; }
+
+    // histogram colors are converted once, palettes once per iteration
+    std::vector<std::array<i32, 3>> coords(entries.size());
+    {
+        std::vector<color> colors(entries.size());
+        std::ranges::transform(entries, colors.begin(), [](auto const& e) { return e.get_color(); });
+        convert_colors(space, colors, coords);
+    }
+
+    f64 const channels {static_cast<f64>(hist.pixel_count()) * 3.0};
+    for (i32 iteration {0};; ++iteration) {
+        palette_matcher const matcher {retValue.Palette, space};
+        auto const            result {assign(matcher, entries, coords, threads)};
+        retValue.Mse.push_back(static_cast<f64>(result.SquaredError) / channels);
+        if (iteration == iterations) { break; }
+
+        // update step: every entry moves to the mean of its colors; outside RGB this is the mean
+        // in sRGB, as there is no conversion back
+        std::vector<color> next {retValue.Palette};
+        std::vector<usize> empty;
+        for (usize k {0}; k < next.size(); ++k) {
+            cluster const& c {result.Clusters[k]};
+            if (c.Count == 0) {
+                empty.push_back(k);
+                continue;
+            }
+            auto const mean {[&](i64 sum) { return static_cast<u8>((sum + (c.Count / 2)) / c.Count); }};
+            next[k].R = mean(c.R);
+            next[k].G = mean(c.G);
+            next[k].B = mean(c.B);
+        }
+
+        // unused entries restart at the colors with the largest weighted error
+        if (!empty.empty()) {
+            std::vector<usize> worst(entries.size());
+            std::iota(worst.begin(), worst.end(), usize {0});
+            usize const count {std::min(empty.size(), worst.size())};
+            std::partial_sort(worst.begin(), worst.begin() + static_cast<isize>(count), worst.end(),
+                              [&](usize a, usize b) { return result.Errors[a] > result.Errors[b]; });
+            for (usize i {0}; i < count; ++i) {
+                if (result.Errors[worst[i]] == 0) { break; }
+                color const c {entries[worst[i]].get_color()};
+                next[empty[i]].R = c.R;
+                next[empty[i]].G = c.G;
+                next[empty[i]].B = c.B;
+            }
+        }
+
+        if (next == retValue.Palette) { break; } // converged
+        retValue.Palette = std::move(next);
+    }
+    return retValue;
+}
+
+auto refine_palette(std::span<color const> palette, color_histogram const& hist, options const& opts) -> std::vector<color>
+{
+    if (opts.Refine <= 0) { return {palette.begin(), palette.end()}; }
+
+    auto const sw {stopwatch::StartNew()};
+    auto       result {refine_palette(palette, hist, opts.ColorSpace, opts.Refine, opts.Threads)};
+    if (result.Mse.empty()) { return std::move(result.Palette); }
+
+    for (usize i {0}; i < result.Mse.size(); ++i) {
+        if (opts.ColorSpace == color_space::RGB) {
+            std::cout << std::format("refine {}: MSE {:.2f}, PSNR {:.2f}dB\n", i, result.Mse[i], psnr(result.Mse[i]));
+        } else {
+            std::cout << std::format("refine {}: {} MSE {:.2f}\n", i, get_color_space_name(opts.ColorSpace), result.Mse[i]);
+        }
+    }
+    std::cout << std::format("refined in {}ms, {} iterations\n", sw.elapsed_milliseconds(), result.Mse.size() - 1);
+    return std::move(result.Palette);
+}
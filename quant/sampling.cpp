@@ -0,0 +1,131 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+namespace {
+
+auto hash_cell(i32 x, i32 y, u32 seed) -> u32
+{
+    u32 h {(static_cast<u32>(x) * 73856093u) ^ (static_cast<u32>(y) * 19349663u) ^ (seed * 83492791u)};
+    h = (h ^ (h >> 16)) * 0x45d9f3bu;
+    return h ^ (h >> 16);
+}
+
+}
+
+auto make_training_image(gfx::image const& img, f64 rate, i64 maxSamples) -> std::optional<gfx::image>
+{
+    auto const& info {img.info()};
+    i64 const   pixels {static_cast<i64>(info.Size.Width) * info.Size.Height};
+
+    i64 target {pixels};
+    if (rate > 0.0 && rate < 1.0) { target = static_cast<i64>(static_cast<f64>(pixels) * rate); }
+    if (maxSamples > 0) { target = std::min(target, maxSamples); }
+    target = std::max<i64>(target, 1);
+    if (target >= pixels) { return std::nullopt; }
+
+    // stratified: one jittered sample per cell keeps the spatial distribution; cells are square
+    // unless the image is narrower than a cell
+    f64 const area {static_cast<f64>(pixels) / static_cast<f64>(target)};
+    f64 const side {std::sqrt(area)};
+    f64       stepX {side};
+    f64       stepY {side};
+    if (side > info.Size.Width) {
+        stepX = info.Size.Width;
+        stepY = area / stepX;
+    } else if (side > info.Size.Height) {
+        stepY = info.Size.Height;
+        stepX = area / stepY;
+    }
+
+    // whole cells only, so the sample count stays within target; the cells are then stretched to
+    // cover the image
+    i32 cellsX {std::clamp(static_cast<i32>(info.Size.Width / stepX), 1, info.Size.Width)};
+    i32 cellsY {std::clamp(static_cast<i32>(info.Size.Height / stepY), 1, info.Size.Height)};
+    if (cellsX < info.Size.Width && static_cast<i64>(cellsX + 1) * cellsY <= target) { ++cellsX; }
+    if (cellsY < info.Size.Height && static_cast<i64>(cellsX) * (cellsY + 1) <= target) { ++cellsY; }
+    stepX = static_cast<f64>(info.Size.Width) / cellsX;
+    stepY = static_cast<f64>(info.Size.Height) / cellsY;
+    i32 const bpp {info.bytes_per_pixel()};
+
+    auto       retValue {gfx::image::CreateEmpty({cellsX, cellsY}, info.Format)};
+    auto const src {img.data()};
+    auto       dst {retValue.data()};
+
+    for (i32 cy {0}; cy < cellsY; ++cy) {
+        i32 const y0 {static_cast<i32>(cy * stepY)};
+        i32 const y1 {std::clamp(static_cast<i32>((cy + 1) * stepY), y0 + 1, info.Size.Height)};
+        for (i32 cx {0}; cx < cellsX; ++cx) {
+            i32 const x0 {static_cast<i32>(cx * stepX)};
+            i32 const x1 {std::clamp(static_cast<i32>((cx + 1) * stepX), x0 + 1, info.Size.Width)};
+            i32 const x {x0 + static_cast<i32>(hash_cell(cx, cy, 1) % static_cast<u32>(x1 - x0))};
+            i32 const y {y0 + static_cast<i32>(hash_cell(cx, cy, 2) % static_cast<u32>(y1 - y0))};
+
+            std::copy_n(src.data() + ((static_cast<isize>(y) * info.Size.Width) + x) * bpp, bpp,
+                        dst.data() + ((static_cast<isize>(cy) * cellsX) + cx) * bpp);
+        }
+    }
+
+    return retValue;
+}
+
+auto make_training_image(color_histogram const& hist, f64 rate, i64 maxSamples) -> gfx::image
+{
+    constexpr i32 WIDTH {1024};
+
+    auto const entries {hist.entries()};
+    i64 const  pixels {std::max<i64>(1, hist.pixel_count())};
+    auto const colors {static_cast<i64>(entries.size())};
+
+    i64 target {std::numeric_limits<i64>::max()};
+    if (rate > 0.0 && rate < 1.0) { target = static_cast<i64>(static_cast<f64>(pixels) * rate); }
+    if (maxSamples > 0) { target = std::min(target, maxSamples); }
+
+    // the image is padded to whole rows, which must stay within target as well
+    auto const padded {[](i64 count) { return count > WIDTH ? (count + WIDTH - 1) / WIDTH * WIDTH : count; }};
+    bool const exact {padded(pixels) <= target};
+    if (!exact) {
+        target = std::clamp<i64>(target, 1, pixels);
+        if (target > WIDTH) { target -= target % WIDTH; }
+    }
+
+    std::vector<u32> samples;
+    samples.reserve(static_cast<usize>(std::min(target, pixels)));
+    if (exact) {
+        for (auto const& e : entries) { samples.insert(samples.end(), e.Count, e.Color); }
+    } else {
+        // Systematic sampling along the cumulative weights: every color gets a number of samples
+        // proportional to its weight, or is picked with a probability proportional to it, and the
+        // total stays at target. Colors keep one sample each if the target leaves room for that.
+        i64 const base {colors <= target ? 1 : 0};
+        i64 const budget {target - (base * colors)};
+        f64 const step {budget > 0 ? static_cast<f64>(pixels) / static_cast<f64>(budget) : 0.0};
+        i64       weight {0};
+        i64       taken {0};
+        for (auto const& e : entries) {
+            weight += e.Count;
+            i64 const upto {budget > 0 ? std::min(budget, static_cast<i64>((static_cast<f64>(weight) / step) + 0.5)) : 0};
+            i64 const copies {base + upto - taken};
+            taken = upto;
+            samples.insert(samples.end(), static_cast<usize>(copies), e.Color);
+        }
+    }
+    if (samples.empty()) { samples.push_back(0xFF); }
+
+    // pad the last row by repeating from the start
+    i32 const width {static_cast<i32>(std::min<usize>(WIDTH, samples.size()))};
+    i32 const height {static_cast<i32>((samples.size() + width - 1) / width)};
+    auto      retValue {gfx::image::CreateEmpty({width, height}, gfx::image::format::RGBA)};
+    auto      dst {retValue.data()};
+    for (usize i {0}; i < static_cast<usize>(width) * height; ++i) {
+        u32 const c {samples[i % samples.size()]};
+        dst[(i * 4) + 0] = static_cast<u8>(c >> 24);
+        dst[(i * 4) + 1] = static_cast<u8>(c >> 16);
+        dst[(i * 4) + 2] = static_cast<u8>(c >> 8);
+        dst[(i * 4) + 3] = static_cast<u8>(c);
+    }
+    return retValue;
+}
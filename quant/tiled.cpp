@@ -0,0 +1,257 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "common.hpp"
+
+namespace {
+
+auto read_le(std::span<u8 const> buf, usize offset, usize bytes) -> u32
+{
+    u32 retValue {0};
+    for (usize i {0}; i < bytes; ++i) { retValue |= static_cast<u32>(buf[offset + i]) << (8 * i); }
+    return retValue;
+}
+
+// next whitespace separated token of a PNM header, skipping comments
+auto read_token(std::ifstream& in) -> string
+{
+    string retValue;
+    char   c {0};
+    while (in.get(c)) {
+        if (c == '#') {
+            while (in.get(c) && c != '\n') { }
+            continue;
+        }
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (!retValue.empty()) { break; }
+            continue;
+        }
+        retValue += c;
+    }
+    return retValue;
+}
+
+}
+
+////////////////////////////////////////////////////////////
+
+scanline_reader::scanline_reader(string const& file)
+    : _in {file, std::ios::binary}
+{
+    if (!_in) { return; }
+
+    std::array<char, 2> magic {};
+    _in.read(magic.data(), 2);
+    bool const valid {magic[0] == 'P' ? open_pnm(magic[1]) : magic[0] == 'B' && magic[1] == 'M' ? open_bmp() : false};
+    if (!valid || _size.Width <= 0 || _size.Height <= 0) { _in.close(); }
+}
+
+auto scanline_reader::is_open() const -> bool
+{
+    return _in.is_open();
+}
+
+auto scanline_reader::size() const -> size_i
+{
+    return _size;
+}
+
+auto scanline_reader::format() const -> gfx::image::format
+{
+    return _channels == 4 && _hasAlpha ? gfx::image::format::RGBA : gfx::image::format::RGB;
+}
+
+auto scanline_reader::row() const -> i32
+{
+    return _row;
+}
+
+auto scanline_reader::read(i32 rows) -> std::optional<gfx::image>
+{
+    rows = std::min(rows, _size.Height - _row);
+    if (!is_open() || rows <= 0) { return std::nullopt; }
+
+    auto const format {this->format()};
+    auto       retValue {gfx::image::CreateEmpty({_size.Width, rows}, format)};
+    auto       dst {retValue.data()};
+    i32 const  bpp {retValue.info().bytes_per_pixel()};
+
+    std::vector<u8> line(static_cast<usize>(_stride));
+    for (i32 y {0}; y < rows; ++y, ++_row) {
+        i32 const fileRow {_bottomUp ? _size.Height - 1 - _row : _row};
+        _in.seekg(_dataOffset + (static_cast<std::streamoff>(fileRow) * _stride));
+        _in.read(reinterpret_cast<char*>(line.data()), _stride);
+        if (!_in) { return std::nullopt; }
+
+        u8* out {dst.data() + (static_cast<isize>(y) * _size.Width * bpp)};
+        for (i32 x {0}; x < _size.Width; ++x) {
+            u8 const* p {line.data() + (static_cast<isize>(x) * _channels)};
+            out[0] = _bgr ? p[2] : p[0];
+            out[1] = p[1];
+            out[2] = _bgr ? p[0] : p[2];
+            if (bpp == 4) { out[3] = p[3]; }
+            out += bpp;
+        }
+    }
+    return retValue;
+}
+
+void scanline_reader::rewind()
+{
+    _in.clear();
+    _row = 0;
+}
+
+// binary P6 (RGB) and P7 (RGB or RGB_ALPHA) with 8 bit samples
+auto scanline_reader::open_pnm(char type) -> bool
+{
+    i32 maxValue {0};
+    if (type == '6') {
+        _size.Width  = std::atoi(read_token(_in).c_str());
+        _size.Height = std::atoi(read_token(_in).c_str());
+        maxValue     = std::atoi(read_token(_in).c_str());
+        _channels    = 3;
+    } else if (type == '7') {
+        for (string token {read_token(_in)}; token != "ENDHDR"; token = read_token(_in)) {
+            if (token.empty()) { return false; }
+            if (token == "WIDTH") { _size.Width = std::atoi(read_token(_in).c_str()); }
+            if (token == "HEIGHT") { _size.Height = std::atoi(read_token(_in).c_str()); }
+            if (token == "DEPTH") { _channels = std::atoi(read_token(_in).c_str()); }
+            if (token == "MAXVAL") { maxValue = std::atoi(read_token(_in).c_str()); }
+        }
+        _hasAlpha = _channels == 4;
+    } else {
+        return false;
+    }
+    if (maxValue != 255 || (_channels != 3 && _channels != 4)) { return false; }
+
+    _dataOffset = _in.tellg();
+    _stride     = static_cast<isize>(_size.Width) * _channels;
+    return true;
+}
+
+// uncompressed 24 bit and 32 bit files; 32 bit alpha is only trusted with an explicit mask
+auto scanline_reader::open_bmp() -> bool
+{
+    // file header, info header and the color masks that follow it or are part of it
+    std::array<u8, 70> header {};
+    _in.read(reinterpret_cast<char*>(header.data() + 2), 52);
+    if (_in.gcount() < 52) { return false; }
+    _in.read(reinterpret_cast<char*>(header.data() + 54), 16);
+    _in.clear();
+
+    u32 const infoSize {read_le(header, 14, 4)};
+    if (infoSize < 40) { return false; }
+
+    auto const height {static_cast<i32>(read_le(header, 22, 4))};
+    u32 const  bits {read_le(header, 28, 2)};
+    u32 const  compression {read_le(header, 30, 4)};
+    bool const bitfields {compression == 3 && bits == 32 && read_le(header, 54, 4) == 0x00FF0000 && read_le(header, 58, 4) == 0x0000FF00 && read_le(header, 62, 4) == 0x000000FF};
+    if ((bits != 24 && bits != 32) || (compression != 0 && !bitfields)) { return false; }
+
+    _size       = {static_cast<i32>(read_le(header, 18, 4)), std::abs(height)};
+    _channels   = static_cast<i32>(bits / 8);
+    _hasAlpha   = bitfields && infoSize >= 56 && read_le(header, 66, 4) == 0xFF000000;
+    _bgr        = true;
+    _bottomUp   = height > 0;
+    _dataOffset = read_le(header, 10, 4);
+    _stride     = ((static_cast<isize>(_size.Width) * bits + 31) / 32) * 4;
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+
+auto quantize_tiled(options const& opts, string const& quantizer, string const& input, string const& output) -> i32
+{
+    auto const sw {stopwatch::StartNew()};
+
+    scanline_reader reader {input};
+    if (!reader.is_open()) { return print_error("tiled mode reads binary ppm/pam or uncompressed 24/32 bit bmp files: " + input); }
+    if (!is_indexed_format(output)) { return print_error("tiled mode writes indexed png, bmp, pcx or gif files: " + output); }
+
+    auto const size {reader.size()};
+    i32 const  bandRows {opts.TileRows};
+    std::cout << std::format("tiled: {}x{}, bands of {} rows ({:.1f}MB each)\n", size.Width, size.Height, bandRows,
+                             static_cast<f64>(size.Width) * bandRows * (reader.format() == gfx::image::format::RGBA ? 4 : 3) / (1024.0 * 1024.0));
+
+    // first pass: histogram of a stratified sample per band, merged every few bands
+    std::vector<color> pal;
+    bool               transparent {false};
+    if (!opts.PaletteFile.empty()) {
+        auto loaded {read_palette(opts.PaletteFile)};
+        if (!loaded) { return print_error("error loading palette: " + opts.PaletteFile); }
+        pal = std::move(*loaded);
+        // without a first pass there is no way to tell, so keep the entry available
+        transparent = reader.format() == gfx::image::format::RGBA;
+    } else {
+        constexpr usize MERGE_BANDS {16};
+
+        // --max-samples is split between the bands by their share of the rows
+        auto const bandSamples {[&](i32 rows) -> i64 {
+            if (opts.MaxSamples <= 0) { return 0; }
+            return std::max<i64>(1, opts.MaxSamples * rows / size.Height);
+        }};
+
+        std::vector<color_histogram> pending(1);
+        while (auto band {reader.read(bandRows)}) {
+            auto const sample {make_training_image(*band, opts.SampleRate, bandSamples(band->info().Size.Height))};
+            pending.push_back(color_histogram::Build(sample ? *sample : *band, opts.Threads));
+            if (pending.size() > MERGE_BANDS) { pending = {color_histogram::Merge(pending)}; }
+            transparent = transparent || has_transparency(*band);
+        }
+        if (reader.row() != size.Height) { return print_error("error reading image: " + input); }
+
+        auto const hist {color_histogram::Merge(pending)};
+        pending.clear();
+        std::cout << std::format("sampled {} of {} pixels, {} colors in {}ms\n", hist.pixel_count(), static_cast<i64>(size.Width) * size.Height, hist.color_count(), sw.elapsed_milliseconds());
+
+        auto const paletteSw {stopwatch::StartNew()};
+        // the bands were sampled already, and one entry stays free for transparent pixels
+        options trainOpts {opts};
+        trainOpts.SampleRate = 1.0;
+        if (transparent) { trainOpts.Colors = std::min(opts.Colors, 255); }
+        pal = train_palette(quantizer, hist, trainOpts);
+        std::cout << std::format("palette: {} colors in {}ms\n", pal.size(), paletteSw.elapsed_milliseconds());
+        pal = refine_palette(pal, hist, opts);
+        reader.rewind();
+    }
+    if (!opts.SavePalette.empty() && !write_palette(opts.SavePalette, pal)) { return print_error("error saving palette: " + opts.SavePalette); }
+
+    std::vector<color> outPalette {pal};
+    if (transparent) { outPalette.push_back(color {0, 0, 0, 0}); }
+    if (outPalette.size() > 256) { return print_error("indexed output supports at most 256 colors, including one for transparent pixels"); }
+
+    palette_matcher matcher {pal, opts.ColorSpace};
+    if (opts.ColormapBits > 0) { matcher.build_colormap(opts.ColormapBits, opts.ColormapExact, opts.Threads); }
+
+    auto writer {indexed_writer::Create(output, size, outPalette)};
+    if (!writer) { return print_error("error creating image: " + output); }
+
+    // second pass: error diffusion continues across band boundaries through the band state
+    auto const  ditherSw {stopwatch::StartNew()};
+    dither_band state {.ImageSize = size};
+    f64         squaredError {0.0};
+    i64         opaquePixels {0};
+    while (auto band {reader.read(bandRows)}) {
+        indexed_image part {.Size = band->info().Size, .Indices = dither_indices(*band, matcher, opts.Dithering, state, opts.Threads), .Palette = outPalette};
+        isize         opaque {std::ssize(part.Indices)};
+        if (transparent && mark_transparent(*band, part.Indices, static_cast<u8>(pal.size()))) {
+            opaque -= std::ranges::count(part.Indices, static_cast<u8>(pal.size()));
+        }
+        squaredError += mean_squared_error(*band, part) * static_cast<f64>(opaque);
+        opaquePixels += opaque;
+        writer->write_rows(part.Indices);
+    }
+    if (reader.row() != size.Height) { return print_error("error reading image: " + input); }
+    if (!writer->finish()) { return print_error("error saving image: " + output); }
+
+    auto const ditherMs {ditherSw.elapsed_milliseconds()};
+    f64 const  mpix {static_cast<f64>(size.Width) * size.Height / 1.0e6};
+    f64 const  mse {opaquePixels > 0 ? squaredError / static_cast<f64>(opaquePixels) : 0.0};
+    std::cout << std::format("dithering: {}ms, {:.1f} Mpix/s\n", ditherMs, ditherMs > 0 ? mpix / ditherMs * 1000.0 : 0.0);
+    std::cout << std::format("MSE: {:.2f}, PSNR: {:.2f}dB\n", mse, psnr(mse));
+    std::cout << std::format("done in {}ms!\n", sw.elapsed_milliseconds());
+    return 0;
+}
@@ -0,0 +1,335 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "../shared/parallel.hpp"
+#include "common.hpp"
+
+#include <mutex>
+
+// Xiaolin Wu, "Efficient Statistical Computations for Optimal Color Quantization", Graphics Gems II
+
+namespace {
+
+// 5 bits per channel plus a zero border for the cumulative tables
+constexpr i32 SIDE {33};
+constexpr i32 SHIFT {3};
+
+enum class axis : u8 {
+    Red,
+    Green,
+    Blue
+};
+
+struct box {
+    i32 R0 {0}; // exclusive
+    i32 R1 {0}; // inclusive
+    i32 G0 {0};
+    i32 G1 {0};
+    i32 B0 {0};
+    i32 B1 {0};
+
+    auto volume() const -> i32 { return (R1 - R0) * (G1 - G0) * (B1 - B0); }
+};
+
+auto index_of(i32 r, i32 g, i32 b) -> usize
+{
+    return static_cast<usize>((r * SIDE * SIDE) + (g * SIDE) + b);
+}
+
+using table = std::vector<i64>;
+
+struct moments {
+    table Weight;
+    table R;
+    table G;
+    table B;
+    table Squared;
+
+    moments()
+        : Weight(SIDE * SIDE * SIDE, 0)
+        , R(SIDE * SIDE * SIDE, 0)
+        , G(SIDE * SIDE * SIDE, 0)
+        , B(SIDE * SIDE * SIDE, 0)
+        , Squared(SIDE * SIDE * SIDE, 0)
+    {
+    }
+
+    void add(moments const& other)
+    {
+        for (usize i {0}; i < Weight.size(); ++i) {
+            Weight[i] += other.Weight[i];
+            R[i] += other.R[i];
+            G[i] += other.G[i];
+            B[i] += other.B[i];
+            Squared[i] += other.Squared[i];
+        }
+    }
+};
+
+// per-thread histograms merged at the end; all sums are integers, so the result does not
+// depend on the thread count
+auto build_histogram(gfx::image const& img, i32 threads) -> moments
+{
+    auto const& info {img.info()};
+    i32 const   bpp {info.bytes_per_pixel()};
+    auto const  data {img.data()};
+
+    moments    retValue;
+    std::mutex mutex;
+    parallel_for(info.Size.Height, threads, [&](isize begin, isize end) {
+        moments local;
+        for (isize y {begin}; y < end; ++y) {
+            u8 const* p {data.data() + (y * info.Size.Width * bpp)};
+            for (i32 x {0}; x < info.Size.Width; ++x, p += bpp) {
+                i32 const   r {p[0]};
+                i32 const   g {p[1]};
+                i32 const   b {p[2]};
+                usize const idx {index_of((r >> SHIFT) + 1, (g >> SHIFT) + 1, (b >> SHIFT) + 1)};
+                ++local.Weight[idx];
+                local.R[idx] += r;
+                local.G[idx] += g;
+                local.B[idx] += b;
+                local.Squared[idx] += (r * r) + (g * g) + (b * b);
+            }
+        }
+
+        std::scoped_lock lock {mutex};
+        retValue.add(local);
+    });
+
+    return retValue;
+}
+
+auto build_histogram(color_histogram const& hist) -> moments
+{
+    moments retValue;
+    for (auto const& e : hist.entries()) {
+        color const c {e.get_color()};
+        i64 const   count {e.Count};
+        usize const idx {index_of((c.R >> SHIFT) + 1, (c.G >> SHIFT) + 1, (c.B >> SHIFT) + 1)};
+        retValue.Weight[idx] += count;
+        retValue.R[idx] += c.R * count;
+        retValue.G[idx] += c.G * count;
+        retValue.B[idx] += c.B * count;
+        retValue.Squared[idx] += ((c.R * c.R) + (c.G * c.G) + (c.B * c.B)) * count;
+    }
+    return retValue;
+}
+
+// turn the histogram into cumulative moments, so any box can be summed in 8 lookups
+void accumulate(table& t)
+{
+    for (i32 r {1}; r < SIDE; ++r) {
+        std::array<i64, SIDE> area {};
+        for (i32 g {1}; g < SIDE; ++g) {
+            i64 line {0};
+            for (i32 b {1}; b < SIDE; ++b) {
+                line += t[index_of(r, g, b)];
+                area[b] += line;
+                t[index_of(r, g, b)] = t[index_of(r - 1, g, b)] + area[b];
+            }
+        }
+    }
+}
+
+auto volume(box const& c, table const& t) -> i64
+{
+    return t[index_of(c.R1, c.G1, c.B1)] - t[index_of(c.R1, c.G1, c.B0)]
+        - t[index_of(c.R1, c.G0, c.B1)] + t[index_of(c.R1, c.G0, c.B0)]
+        - t[index_of(c.R0, c.G1, c.B1)] + t[index_of(c.R0, c.G1, c.B0)]
+        + t[index_of(c.R0, c.G0, c.B1)] - t[index_of(c.R0, c.G0, c.B0)];
+}
+
+// the part of volume() that does not depend on the cut position
+auto bottom(box const& c, axis dir, table const& t) -> i64
+{
+    switch (dir) {
+    case axis::Red:
+        return -t[index_of(c.R0, c.G1, c.B1)] + t[index_of(c.R0, c.G1, c.B0)]
+            + t[index_of(c.R0, c.G0, c.B1)] - t[index_of(c.R0, c.G0, c.B0)];
+    case axis::Green:
+        return -t[index_of(c.R1, c.G0, c.B1)] + t[index_of(c.R1, c.G0, c.B0)]
+            + t[index_of(c.R0, c.G0, c.B1)] - t[index_of(c.R0, c.G0, c.B0)];
+    case axis::Blue:
+        return -t[index_of(c.R1, c.G1, c.B0)] + t[index_of(c.R1, c.G0, c.B0)]
+            + t[index_of(c.R0, c.G1, c.B0)] - t[index_of(c.R0, c.G0, c.B0)];
+    }
+    return 0;
+}
+
+auto top(box const& c, axis dir, i32 pos, table const& t) -> i64
+{
+    switch (dir) {
+    case axis::Red:
+        return t[index_of(pos, c.G1, c.B1)] - t[index_of(pos, c.G1, c.B0)]
+            - t[index_of(pos, c.G0, c.B1)] + t[index_of(pos, c.G0, c.B0)];
+    case axis::Green:
+        return t[index_of(c.R1, pos, c.B1)] - t[index_of(c.R1, pos, c.B0)]
+            - t[index_of(c.R0, pos, c.B1)] + t[index_of(c.R0, pos, c.B0)];
+    case axis::Blue:
+        return t[index_of(c.R1, c.G1, pos)] - t[index_of(c.R1, c.G0, pos)]
+            - t[index_of(c.R0, c.G1, pos)] + t[index_of(c.R0, c.G0, pos)];
+    }
+    return 0;
+}
+
+auto variance(box const& c, moments const& m) -> f64
+{
+    auto const dr {static_cast<f64>(volume(c, m.R))};
+    auto const dg {static_cast<f64>(volume(c, m.G))};
+    auto const db {static_cast<f64>(volume(c, m.B))};
+    auto const xx {static_cast<f64>(volume(c, m.Squared))};
+    auto const w {static_cast<f64>(volume(c, m.Weight))};
+    return w > 0 ? xx - (((dr * dr) + (dg * dg) + (db * db)) / w) : 0.0;
+}
+
+struct cut_result {
+    f64 Max {0.0};
+    i32 Position {-1};
+};
+
+// best split position along one axis, maximizing the between-box sum of squares
+auto maximize(box const& c, axis dir, i32 first, i32 last, std::array<i64, 4> const& whole, moments const& m) -> cut_result
+{
+    i64 const baseR {bottom(c, dir, m.R)};
+    i64 const baseG {bottom(c, dir, m.G)};
+    i64 const baseB {bottom(c, dir, m.B)};
+    i64 const baseW {bottom(c, dir, m.Weight)};
+
+    cut_result retValue;
+    for (i32 i {first}; i < last; ++i) {
+        auto halfR {static_cast<f64>(baseR + top(c, dir, i, m.R))};
+        auto halfG {static_cast<f64>(baseG + top(c, dir, i, m.G))};
+        auto halfB {static_cast<f64>(baseB + top(c, dir, i, m.B))};
+        auto halfW {static_cast<f64>(baseW + top(c, dir, i, m.Weight))};
+        if (halfW == 0) { continue; }
+        f64 temp {((halfR * halfR) + (halfG * halfG) + (halfB * halfB)) / halfW};
+
+        halfR = static_cast<f64>(whole[0]) - halfR;
+        halfG = static_cast<f64>(whole[1]) - halfG;
+        halfB = static_cast<f64>(whole[2]) - halfB;
+        halfW = static_cast<f64>(whole[3]) - halfW;
+        if (halfW == 0) { continue; }
+        temp += ((halfR * halfR) + (halfG * halfG) + (halfB * halfB)) / halfW;
+
+        if (temp > retValue.Max) {
+            retValue.Max      = temp;
+            retValue.Position = i;
+        }
+    }
+    return retValue;
+}
+
+auto cut(box& set1, box& set2, moments const& m) -> bool
+{
+    std::array<i64, 4> const whole {volume(set1, m.R), volume(set1, m.G), volume(set1, m.B), volume(set1, m.Weight)};
+
+    cut_result const red {maximize(set1, axis::Red, set1.R0 + 1, set1.R1, whole, m)};
+    cut_result const green {maximize(set1, axis::Green, set1.G0 + 1, set1.G1, whole, m)};
+    cut_result const blue {maximize(set1, axis::Blue, set1.B0 + 1, set1.B1, whole, m)};
+
+    axis dir {};
+    if (red.Max >= green.Max && red.Max >= blue.Max) {
+        dir = axis::Red;
+        if (red.Position < 0) { return false; } // box can't be split
+    } else if (green.Max >= red.Max && green.Max >= blue.Max) {
+        dir = axis::Green;
+    } else {
+        dir = axis::Blue;
+    }
+
+    set2.R1 = set1.R1;
+    set2.G1 = set1.G1;
+    set2.B1 = set1.B1;
+
+    switch (dir) {
+    case axis::Red:
+        set2.R0 = set1.R1 = red.Position;
+        set2.G0           = set1.G0;
+        set2.B0           = set1.B0;
+        break;
+    case axis::Green:
+        set2.G0 = set1.G1 = green.Position;
+        set2.R0           = set1.R0;
+        set2.B0           = set1.B0;
+        break;
+    case axis::Blue:
+        set2.B0 = set1.B1 = blue.Position;
+        set2.R0           = set1.R0;
+        set2.G0           = set1.G0;
+        break;
+    }
+    return true;
+}
+
+auto build_palette(moments& m, i32 colors) -> std::vector<color>
+{
+    colors = std::clamp(colors, 1, 256);
+
+    accumulate(m.Weight);
+    accumulate(m.R);
+    accumulate(m.G);
+    accumulate(m.B);
+    accumulate(m.Squared);
+
+    std::vector<box> cubes(static_cast<usize>(colors));
+    std::vector<f64> vv(static_cast<usize>(colors), 0.0);
+    cubes[0].R1 = cubes[0].G1 = cubes[0].B1 = SIDE - 1;
+
+    // repeatedly split the box with the largest variance
+    i32 count {colors};
+    i32 next {0};
+    for (i32 i {1}; i < count; ++i) {
+        if (cut(cubes[next], cubes[i], m)) {
+            vv[next] = cubes[next].volume() > 1 ? variance(cubes[next], m) : 0.0;
+            vv[i]    = cubes[i].volume() > 1 ? variance(cubes[i], m) : 0.0;
+        } else {
+            vv[next] = 0.0;
+            --i;
+        }
+
+        next = 0;
+        f64 temp {vv[0]};
+        for (i32 k {1}; k <= i; ++k) {
+            if (vv[k] > temp) {
+                temp = vv[k];
+                next = k;
+            }
+        }
+        if (temp <= 0.0) {
+            count = i + 1;
+            break;
+        }
+    }
+
+    std::vector<color> retValue;
+    retValue.reserve(static_cast<usize>(count));
+    for (i32 k {0}; k < count; ++k) {
+        i64 const weight {volume(cubes[k], m.Weight)};
+        if (weight <= 0) { continue; }
+        retValue.push_back(color {
+            static_cast<u8>((volume(cubes[k], m.R) + (weight / 2)) / weight),
+            static_cast<u8>((volume(cubes[k], m.G) + (weight / 2)) / weight),
+            static_cast<u8>((volume(cubes[k], m.B) + (weight / 2)) / weight),
+            255});
+    }
+    return retValue;
+}
+
+}
+
+////////////////////////////////////////////////////////////
+
+auto wu_quant::GetPalette(gfx::image const& img, i32 colors, i32 threads) -> std::vector<color>
+{
+    moments m {build_histogram(img, threads)};
+    return build_palette(m, colors);
+}
+
+auto wu_quant::GetPalette(color_histogram const& hist, i32 colors) -> std::vector<color>
+{
+    moments m {build_histogram(hist)};
+    return build_palette(m, colors);
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2026 Tobias Bohnen
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Splits [0, count) into one contiguous range per thread and calls func(begin, end) for each.
+// threads <= 0 uses all hardware threads. Runs inline if there is only one range.
+template <typename Func>
+void parallel_for(std::ptrdiff_t count, int threads, Func&& func)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    std::ptrdiff_t const ranges {std::min<std::ptrdiff_t>(threads, count)};
+    if (ranges == 1) {
+        func(std::ptrdiff_t {0}, count);
+        return;
+    }
+
+    std::vector<std::jthread> workers;
+    workers.reserve(static_cast<std::size_t>(ranges - 1));
+    for (std::ptrdiff_t i {1}; i < ranges; ++i) {
+        workers.emplace_back([&func, count, ranges, i] {
+            func((count * i) / ranges, (count * (i + 1)) / ranges);
+        });
+    }
+    func(std::ptrdiff_t {0}, count / ranges);
+}